@@ -1,32 +1,52 @@
 #include <imgui.h>
 #include <tinyfiledialogs.h>
 
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
 #include <cstdlib>
 #include <fstream>
-#include <functional>
 #include <iostream>
-#include <sstream>
 #include <unordered_map>
 
 #include "ainb_editor.hpp"
 #include "file_formats/ainb.hpp"
+#include "layout.hpp"
 #include "node_editor/imgui_node_editor.h"
+#include "util/profiler.hpp"
+
+// Position of default value nodes relative to the node they belong to
+#define DEFAULT_VALUE_NODE_OFFSET 250
+#define DEFAULT_VALUE_NODE_SPACING 70
+// Time in seconds that nodes take to move to their auto layout positions
+#define LAYOUT_ANIMATION_TIME 0.3
+// Milliseconds per frame spent on steps of the force directed layout
+#define FORCE_LAYOUT_FRAME_TIME 8
 
 AINBEditor::AINBEditor() {
     edConfig.SettingsFile = nullptr;
+    edConfig.SaveNodeSettings = SaveNodeSettings;
+    edConfig.UserPointer = this;
     edConfig.NavigateButtonIndex = 2;
 }
 
 AINBEditor::~AINBEditor() {
+    StoreLayout();
     ed::DestroyEditor(edContext);
 }
 
-void AINBEditor::RegisterAINB(AINB &ainb) {
+void AINBEditor::RegisterAINB(AINB &ainb, u64 layoutKey) {
+    AINBY_PROFILE_SCOPE("AINBEditor::RegisterAINB");
+    StoreLayout();
     this->ainb = &ainb;
+    this->layoutKey = layoutKey;
     guiNodes.clear();
     for (AINB::Node &node : ainb.nodes) {
         guiNodes.emplace_back(node);
     }
+    userPlacedNodes.assign(guiNodes.size(), false);
 
     if (edContext != nullptr) {
         ed::DestroyEditor(edContext);
@@ -34,16 +54,273 @@ void AINBEditor::RegisterAINB(AINB &ainb) {
     edContext = ed::CreateEditor(&edConfig);
     selectedNodeIdx = -1;
     selectedCommand = "";
+    relayoutNodes.clear();
+    CancelLayout();
+    PrepareInspector();
+    RestoreLayout();
 }
 
 void AINBEditor::UnloadAINB() {
+    StoreLayout();
     guiNodes.clear();
     ainb = nullptr;
     selectedNodeIdx = -1;
     selectedCommand = "";
+    inspectorNodes.clear();
+    filteredNodes.clear();
+    nodeDetails.clear();
+    nodeDetailsIdx = -1;
+    userPlacedNodes.clear();
+    cachedPositions.clear();
+    relayoutNodes.clear();
+    CancelLayout();
+}
+
+bool AINBEditor::IsBusy() const {
+    return layoutPending || !layoutAnimationTo.empty() || forceLayout != nullptr || !cachedPositions.empty()
+        || !relayoutNodes.empty() || !newAuxInfos.empty() || ed::IsAnimating(edContext);
+}
+
+void AINBEditor::SetView(ImVec2 center, float zoom) {
+    viewPending = true;
+    pendingViewCenter = center;
+    pendingViewZoom = zoom;
+}
+
+void AINBEditor::ApplyView(ImVec2 canvasSize) {
+    if (!viewPending) {
+        return;
+    }
+    viewPending = false;
+
+    ImVec2 min(FLT_MAX, FLT_MAX);
+    ImVec2 max(-FLT_MAX, -FLT_MAX);
+    for (const AINBImGuiNode &guiNode : guiNodes) {
+        ImVec2 pos = ed::GetNodePosition(guiNode.GetNodeID());
+        if (pos.x == FLT_MAX) {
+            continue;
+        }
+        ImVec2 size = guiNode.GetSize();
+        min = ImVec2(std::min(min.x, pos.x), std::min(min.y, pos.y));
+        max = ImVec2(std::max(max.x, pos.x + size.x), std::max(max.y, pos.y + size.y));
+    }
+    if (min.x > max.x) {
+        return;
+    }
+
+    ImVec2 center(min.x + (max.x - min.x) * pendingViewCenter.x, min.y + (max.y - min.y) * pendingViewCenter.y);
+    ImVec2 halfSize((max.x - min.x) / 2, (max.y - min.y) / 2);
+    if (pendingViewZoom > 0) {
+        halfSize = ImVec2(canvasSize.x / pendingViewZoom / 2, canvasSize.y / pendingViewZoom / 2);
+    }
+    ed::NavigateToRect(ImVec2(center.x - halfSize.x, center.y - halfSize.y), ImVec2(center.x + halfSize.x, center.y + halfSize.y), 0.0f);
+}
+
+void AINBEditor::SetLayoutCache(LayoutCache *cache) {
+    layoutCache = cache;
+}
+
+void AINBEditor::RestoreLayout() {
+    cachedPositions.clear();
+    size_t positionCount = 0;
+    for (const AINBImGuiNode &guiNode : guiNodes) {
+        positionCount += 1 + guiNode.GetNonNodeInputs().size();
+    }
+    try {
+        if (layoutCache != nullptr && layoutCache->Load(layoutKey, cachedPositions) && cachedPositions.size() == positionCount) {
+            return;
+        }
+    } catch (std::exception &e) {
+        std::cout << "Error reading layout cache: " << e.what() << std::endl;
+    }
+    // Never seen before, so it gets a fresh layout
+    cachedPositions.clear();
+    AutoLayout();
+}
+
+void AINBEditor::ApplyCachedLayout() {
+    if (cachedPositions.empty()) {
+        return;
+    }
+    size_t i = 0;
+    for (const AINBImGuiNode &guiNode : guiNodes) {
+        ed::SetNodePosition(guiNode.GetNodeID(), ImVec2(cachedPositions[i].x, cachedPositions[i].y));
+        i++;
+        for (const AINBImGuiNode::NonNodeInput &input : guiNode.GetNonNodeInputs()) {
+            ed::SetNodePosition(input.genNodeID, ImVec2(cachedPositions[i].x, cachedPositions[i].y));
+            i++;
+        }
+    }
+    cachedPositions.clear();
+}
+
+void AINBEditor::StoreLayout() {
+    // Layouts that are still being computed or moved in are not final yet
+    if (layoutCache == nullptr || edContext == nullptr || guiNodes.empty() || layoutPending
+        || !layoutAnimationTo.empty() || !cachedPositions.empty()) {
+        return;
+    }
+
+    ed::EditorContext *previousEditor = ed::GetCurrentEditor();
+    ed::SetCurrentEditor(edContext);
+    std::vector<LayoutPos> positions;
+    for (const AINBImGuiNode &guiNode : guiNodes) {
+        ImVec2 pos = ed::GetNodePosition(guiNode.GetNodeID());
+        positions.push_back({ pos.x, pos.y });
+        for (const AINBImGuiNode::NonNodeInput &input : guiNode.GetNonNodeInputs()) {
+            pos = ed::GetNodePosition(input.genNodeID);
+            positions.push_back({ pos.x, pos.y });
+        }
+    }
+    ed::SetCurrentEditor(previousEditor);
+
+    for (const LayoutPos &pos : positions) {
+        if (pos.x == FLT_MAX) {
+            return; // Never drawn
+        }
+    }
+    try {
+        layoutCache->Store(layoutKey, positions);
+    } catch (std::exception &e) {
+        std::cout << "Error writing layout cache: " << e.what() << std::endl;
+    }
+}
+
+void AINBEditor::RelayoutNodes(const std::vector<u32> &nodeIdxs) {
+    relayoutNodes.insert(relayoutNodes.end(), nodeIdxs.begin(), nodeIdxs.end());
+}
+
+void AINBEditor::ApplyIncrementalLayout() {
+    if (relayoutNodes.empty()) {
+        return;
+    }
+    std::vector<LayoutPos> positions;
+    for (const AINBImGuiNode &guiNode : guiNodes) {
+        positions.push_back(GetLayoutPos(guiNode, ed::GetNodePosition(guiNode.GetNodeID())));
+    }
+    positions = IncrementalLayout(MakeLayoutGraph(), std::move(positions), relayoutNodes);
+    for (u32 nodeIdx : relayoutNodes) {
+        if (nodeIdx < guiNodes.size()) {
+            newAuxInfos[nodeIdx] = MakeLayoutAuxInfo(guiNodes[nodeIdx], positions[nodeIdx]);
+            userPlacedNodes[nodeIdx] = false;
+        }
+    }
+    relayoutNodes.clear();
+}
+
+static std::string ToLower(std::string str) {
+    for (char &c : str) {
+        c = tolower((unsigned char) c);
+    }
+    return str;
+}
+
+static void AppendLine(std::vector<std::string> &lines, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    va_list argsCopy;
+    va_copy(argsCopy, args);
+    int len = vsnprintf(nullptr, 0, fmt, argsCopy);
+    va_end(argsCopy);
+    std::string &line = lines.emplace_back(len, '\0');
+    vsnprintf(line.data(), len + 1, fmt, args);
+    va_end(args);
+}
+
+void AINBEditor::PrepareInspector() {
+    inspectorNodes.clear();
+    inspectorNodes.reserve(ainb->nodes.size());
+    char buf[32];
+    for (size_t i = 0; i < ainb->nodes.size(); i++) {
+        const AINB::Node &node = ainb->nodes[i];
+        InspectorNode &inspectorNode = inspectorNodes.emplace_back();
+        snprintf(buf, sizeof(buf), "Node %zu: ", i);
+        inspectorNode.title = buf + node.TypeName();
+
+        inspectorNode.searchText = inspectorNode.title;
+        for (const AINB::Param &param : node.GetParams()) {
+            inspectorNode.searchText += '\n';
+            inspectorNode.searchText += param.name;
+        }
+        for (const AINB::NodeLink &link : node.nodeLinks) {
+            inspectorNode.searchText += '\n';
+            inspectorNode.searchText += link.name;
+        }
+        inspectorNode.searchText = ToLower(std::move(inspectorNode.searchText));
+    }
+    nodeDetails.clear();
+    nodeDetailsIdx = -1;
+    FilterNodes();
+}
+
+void AINBEditor::FilterNodes() {
+    std::string filter = ToLower(nodeFilter);
+    filteredNodes.clear();
+    for (size_t i = 0; i < inspectorNodes.size(); i++) {
+        if (inspectorNodes[i].searchText.find(filter) != std::string::npos) {
+            filteredNodes.push_back(i);
+        }
+    }
+}
+
+void AINBEditor::BuildNodeDetails(size_t nodeIdx) {
+    const AINB::Node &node = ainb->nodes[nodeIdx];
+    nodeDetails.clear();
+    nodeDetailsIdx = nodeIdx;
+    nodeDetailsEditCount = guiNodes[nodeIdx].GetEditCount();
+
+    AppendLine(nodeDetails, "Type: %s", node.TypeName().c_str());
+    AppendLine(nodeDetails, "Index: %d", node.Idx());
+    AppendLine(nodeDetails, "Flags: %08x", node.flags);
+
+    std::string precondString;
+    for (u32 precond : node.preconditionNodes) {
+        precondString += std::to_string(precond) + " ";
+    }
+    AppendLine(nodeDetails, "Preconditions: %s", precondString.c_str());
+
+    AppendLine(nodeDetails, "Params:");
+    for (const AINB::Param &param : node.GetParams()) {
+        switch (param.paramType) {
+            case AINB::ParamType::Immediate: {
+                const AINB::ImmediateParam &ip = static_cast<const AINB::ImmediateParam &>(param);
+                AppendLine(nodeDetails, " Imm %s = %s", param.name.c_str(), AINB::AINBValueToString(ip.value).c_str());
+                break;
+            }
+            case AINB::ParamType::Input: {
+                const AINB::InputParam &ip = static_cast<const AINB::InputParam &>(param);
+                switch (ip.inputNodeIdxs.size()) {
+                    case 0:
+                        AppendLine(nodeDetails, " Input %s = %s", param.name.c_str(), AINB::AINBValueToString(ip.defaultValue).c_str());
+                        break;
+                    case 1:
+                        AppendLine(nodeDetails, " Input %s: N%d.%d (default = %s)", param.name.c_str(),
+                            ip.inputNodeIdxs[0], ip.inputParamIdxs[0],
+                            AINB::AINBValueToString(ip.defaultValue).c_str());
+                        break;
+                    default:
+                        AppendLine(nodeDetails, " Input %s: Multi-param:", param.name.c_str());
+                        for (size_t i = 0; i < ip.inputNodeIdxs.size(); i++) {
+                            AppendLine(nodeDetails, "  N%d.%d", ip.inputNodeIdxs[i], ip.inputParamIdxs[i]);
+                        }
+                        break;
+                }
+                break;
+            }
+            case AINB::ParamType::Output:
+                AppendLine(nodeDetails, " Output %s", param.name.c_str());
+                break;
+        }
+    }
+
+    AppendLine(nodeDetails, "Links:");
+    for (const AINB::NodeLink &link : node.nodeLinks) {
+        AppendLine(nodeDetails, " Type %d: to node %d with %s", static_cast<int>(link.type), link.idx, link.name.c_str());
+    }
 }
 
 void AINBEditor::DrawInspector() {
+    AINBY_PROFILE_SCOPE("AINBEditor::DrawInspector");
     ImGui::Text("Name: %s", ainb->name.c_str());
     ImGui::Text("File Category: %s", ainb->fileCategory.c_str());
 
@@ -62,69 +339,30 @@ void AINBEditor::DrawInspector() {
     }
 
     if (ImGui::TreeNode("Nodes")) {
-        for (size_t i = 0; i < ainb->nodes.size(); i++) {
-            std::stringstream title;
-            title << "Node " << i << ": " << ainb->nodes[i].TypeName();
-            ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_None;
-            if (i == selectedNodeIdx) {
-                flags |= ImGuiTreeNodeFlags_Selected;
-            }
-            if (ImGui::TreeNodeEx(title.str().c_str(), flags)) {
-                ImGui::Text("Type: %s", ainb->nodes[i].TypeName().c_str());
-                ImGui::Text("Index: %d", ainb->nodes[i].Idx());
-                ImGui::Text("Flags: %08x", ainb->nodes[i].flags);
-
-                std::stringstream precondString;
-                for (u32 precond : ainb->nodes[i].preconditionNodes) {
-                    precondString << precond << " ";
-                }
-                ImGui::Text("Preconditions: %s", precondString.str().c_str());
-
-                ImGui::Text("Params:");
-                for (AINB::Param &param : ainb->nodes[i].GetParams()) {
-                    switch (param.paramType) {
-                        case AINB::ParamType::Immediate: {
-                            AINB::ImmediateParam &ip = static_cast<AINB::ImmediateParam &>(param);
-                            ImGui::Text(" Imm %s = %s",
-                                param.name.c_str(), AINB::AINBValueToString(ip.value).c_str());
-                            break;
-                        }
-                        case AINB::ParamType::Input: {
-                            AINB::InputParam &ip = static_cast<AINB::InputParam &>(param);
-
-                            switch (ip.inputNodeIdxs.size()) {
-                                case 0:
-                                    ImGui::Text(" Input %s = %s", param.name.c_str(), AINB::AINBValueToString(ip.defaultValue).c_str());
-                                    break;
-                                case 1:
-                                    ImGui::Text(" Input %s: N%d.%d (default = %s)", param.name.c_str(),
-                                        ip.inputNodeIdxs[0], ip.inputParamIdxs[0],
-                                        AINB::AINBValueToString(ip.defaultValue).c_str());
-                                    break;
-                                default:
-                                    ImGui::Text(" Input %s: Multi-param:", param.name.c_str());
-                                    for (size_t i = 0; i < ip.inputNodeIdxs.size(); i++) {
-                                        ImGui::Text("  N%d.%d", ip.inputNodeIdxs[i], ip.inputParamIdxs[i]);
-                                    }
-                                    break;
-                            }
-                            break;
-                        }
-                        case AINB::ParamType::Output:
-                            ImGui::Text(" Output %s", param.name.c_str());
-                            break;
+        ImGui::SetNextItemWidth(-FLT_MIN);
+        if (ImGui::InputTextWithHint("##NodeFilter", "Filter", nodeFilter, sizeof(nodeFilter))) {
+            FilterNodes();
+        }
+        if (ImGui::BeginListBox("##Nodes", ImVec2(FLT_MIN, 300))) {
+            ImGuiListClipper clipper;
+            clipper.Begin(filteredNodes.size());
+            while (clipper.Step()) {
+                for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+                    size_t i = filteredNodes[row];
+                    if (ImGui::Selectable(inspectorNodes[i].title.c_str(), i == selectedNodeIdx)) {
+                        newSelectedNodeIdx = i;
                     }
                 }
+            }
+            ImGui::EndListBox();
+        }
 
-                ImGui::Text("Links:");
-                for (AINB::NodeLink &link : ainb->nodes[i].nodeLinks) {
-                    const char *valueString = AINB::AINBValueToString(link.value).c_str();
-                    ImGui::Text(" Type %d: to node %d with %s", static_cast<int>(link.type), link.idx, link.name.c_str());
-                }
-                ImGui::TreePop();
+        if (selectedNodeIdx != -1) {
+            if (selectedNodeIdx != nodeDetailsIdx || guiNodes[selectedNodeIdx].GetEditCount() != nodeDetailsEditCount) {
+                BuildNodeDetails(selectedNodeIdx);
             }
-            if (ImGui::IsItemClicked()) {
-                newSelectedNodeIdx = i;
+            for (const std::string &line : nodeDetails) {
+                ImGui::TextUnformatted(line.c_str());
             }
         }
         ImGui::TreePop();
@@ -156,18 +394,35 @@ void AINBEditor::DrawInspector() {
 }
 
 void AINBEditor::DrawNodeEditor() {
+    AINBY_PROFILE_SCOPE("AINBEditor::DrawNodeEditor");
     ImGui::Text("Node Viewer");
     ImGui::SameLine();
     bool wantAutoLayout = ImGui::Button("Auto layout");
     ImGui::SameLine();
+    ImGui::Checkbox("Animate", &animateLayout);
+    ImGui::SameLine();
+    bool wantForceLayout = ImGui::Button(forceLayout != nullptr ? "Stop force layout" : "Force layout");
+    ImGui::SameLine();
     bool wantLoadPositions = ImGui::Button("Load node positions");
     ImGui::SameLine();
     bool wantSavePositions = ImGui::Button("Save node positions");
+    if (layoutPending) {
+        ImGui::SameLine();
+        ImGui::TextDisabled("Calculating layout...");
+    }
     ImGui::Separator();
 
+    ImVec2 canvasSize = ImGui::GetContentRegionAvail();
     ed::SetCurrentEditor(edContext);
+    ApplyView(canvasSize);
     ed::Begin("AINB Editor", ImVec2(0.0, 0.0f));
 
+    ApplyCachedLayout();
+    ApplyIncrementalLayout();
+    ReceiveLayout();
+    AnimateLayout();
+    StepForceLayout();
+
     if (newAuxInfos.size() > 0) {
         for (AINBImGuiNode &guiNode : guiNodes) {
             if (newAuxInfos.contains(guiNode.GetNode().Idx())) {
@@ -177,6 +432,7 @@ void AINBEditor::DrawNodeEditor() {
         newAuxInfos.clear();
     }
 
+    // Nodes outside of the view only keep their pins alive, so this scales with the visible nodes
     for (AINBImGuiNode &guiNode : guiNodes) {
         guiNode.Draw();
     }
@@ -202,6 +458,14 @@ void AINBEditor::DrawNodeEditor() {
             }
             found:;
         }
+        if (ImGui::MenuItem("Place next to neighbours")) {
+            for (const AINBImGuiNode &guiNode : guiNodes) {
+                if (guiNode.GetNodeID() == rightClickedNode) {
+                    RelayoutNodes({ (u32) guiNode.GetNode().Idx() });
+                    break;
+                }
+            }
+        }
         ImGui::EndPopup();
     }
 
@@ -230,6 +494,13 @@ void AINBEditor::DrawNodeEditor() {
     if (wantAutoLayout) {
         AutoLayout();
     }
+    if (wantForceLayout) {
+        if (forceLayout != nullptr) {
+            forceLayout.reset();
+        } else {
+            StartForceLayout();
+        }
+    }
 
     if (wantSavePositions) {
         std::vector<AINBImGuiNode::AuxInfo> auxInfos;
@@ -247,63 +518,197 @@ void AINBEditor::DrawNodeEditor() {
     }
 }
 
-void AINBEditor::AutoLayout() {
-    // Use a very simple layouting strategy for now
-    std::unordered_map<int, std::pair<int, int>> idxToPos;
-    std::unordered_map<int, std::unordered_map<int, int>> posToIdx;
+LayoutGraph AINBEditor::MakeLayoutGraph() const {
+    LayoutGraph graph;
+    graph.nodes.reserve(guiNodes.size());
+    for (const AINBImGuiNode &guiNode : guiNodes) {
+        ImVec2 size = guiNode.GetSize();
+        // Default value nodes are placed left of their node and count towards its size
+        size_t nonNodeInputCount = guiNode.GetNonNodeInputs().size();
+        if (nonNodeInputCount > 0) {
+            size.x += DEFAULT_VALUE_NODE_OFFSET;
+            size.y = std::max(size.y, (float) nonNodeInputCount * DEFAULT_VALUE_NODE_SPACING);
+        }
+        graph.nodes.push_back({ size.x, size.y });
+        for (const AINB::Node *outNode : guiNode.GetNode().GetOutNodes()) {
+            graph.edges.push_back({ guiNode.GetNode().Idx(), outNode->Idx() });
+        }
+    }
+    for (const AINB::Command &cmd : ainb->commands) {
+        graph.roots.push_back(cmd.rootNode->Idx());
+    }
+    return graph;
+}
 
-    std::function<void(int, std::pair<int, int>)> placeNode;
+AINBImGuiNode::AuxInfo AINBEditor::MakeLayoutAuxInfo(const AINBImGuiNode &guiNode, LayoutPos pos) const {
+    AINBImGuiNode::AuxInfo auxInfo;
+    auxInfo.nodeIdx = guiNode.GetNode().Idx();
+    auxInfo.pos = ImVec2(pos.x, pos.y);
+    if (guiNode.GetNonNodeInputs().size() > 0) {
+        auxInfo.pos.x += DEFAULT_VALUE_NODE_OFFSET;
+    }
 
-    placeNode = [&](int nodeIdx, std::pair<int, int> pos) {
-        if (idxToPos.contains(nodeIdx)) {
+    int extraPinIdx = 0;
+    for (const AINBImGuiNode::NonNodeInput &input : guiNode.GetNonNodeInputs()) {
+        auxInfo.extraNodePos[input.inputParam.name] = ImVec2(auxInfo.pos.x - DEFAULT_VALUE_NODE_OFFSET, auxInfo.pos.y + extraPinIdx * DEFAULT_VALUE_NODE_SPACING);
+        extraPinIdx++;
+    }
+    return auxInfo;
+}
+
+LayoutPos AINBEditor::GetLayoutPos(const AINBImGuiNode &guiNode, ImVec2 nodePos) const {
+    if (guiNode.GetNonNodeInputs().size() > 0) {
+        nodePos.x -= DEFAULT_VALUE_NODE_OFFSET;
+    }
+    return LayoutPos { nodePos.x, nodePos.y };
+}
+
+void AINBEditor::AutoLayout() {
+    AINBY_PROFILE_SCOPE("AINBEditor::AutoLayout");
+    forceLayout.reset();
+    LayoutGraph graph = MakeLayoutGraph();
+
+    u64 generation = ++layoutGeneration;
+    layoutPending = true;
+    layoutPool.Submit([this, graph = std::move(graph), generation] {
+        if (generation != layoutGeneration) {
             return;
         }
-        while (posToIdx[pos.first].contains(pos.second)) {
-            pos.second++;
+        std::vector<LayoutPos> positions = LayeredLayout(graph);
+        std::lock_guard<std::mutex> lock(layoutMutex);
+        readyLayout = std::move(positions);
+        readyLayoutGeneration = generation;
+        layoutReady = true;
+    });
+}
+
+void AINBEditor::ReceiveLayout() {
+    std::vector<LayoutPos> positions;
+    {
+        std::lock_guard<std::mutex> lock(layoutMutex);
+        if (!layoutReady || readyLayoutGeneration != layoutGeneration) {
+            return;
         }
-        idxToPos[nodeIdx] = pos;
-        posToIdx[pos.first][pos.second] = nodeIdx;
+        positions = std::move(readyLayout);
+        layoutReady = false;
+    }
+    layoutPending = false;
+
+    layoutAnimationFrom.clear();
+    layoutAnimationTo.clear();
+    for (const AINBImGuiNode &guiNode : guiNodes) {
+        layoutAnimationTo.push_back(MakeLayoutAuxInfo(guiNode, positions[guiNode.GetNode().Idx()]));
+    }
+    // Everything has a new place now, so nothing counts as placed by hand anymore
+    userPlacedNodes.assign(guiNodes.size(), false);
 
-        const std::vector<const AINB::Node *> &inNodes = ainb->nodes[nodeIdx].GetInNodes();
-        const std::vector<const AINB::Node *> &outNodes = ainb->nodes[nodeIdx].GetOutNodes();
-        for (const AINB::Node *node : outNodes) {
-            placeNode(node->Idx(), {pos.first + 1, pos.second});
+    if (!animateLayout) {
+        for (AINBImGuiNode::AuxInfo &auxInfo : layoutAnimationTo) {
+            newAuxInfos[auxInfo.nodeIdx] = std::move(auxInfo);
         }
-        for (const AINB::Node *node : inNodes) {
-            placeNode(node->Idx(), {pos.first - 1, pos.second});
+        layoutAnimationTo.clear();
+        return;
+    }
+    for (const AINBImGuiNode &guiNode : guiNodes) {
+        layoutAnimationFrom.push_back(guiNode.GetAuxInfo());
+    }
+    layoutAnimationStart = ImGui::GetTime();
+}
+
+static ImVec2 Lerp(ImVec2 a, ImVec2 b, float t) {
+    return ImVec2(a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t);
+}
+
+void AINBEditor::AnimateLayout() {
+    if (layoutAnimationTo.empty()) {
+        return;
+    }
+    float t = std::min((ImGui::GetTime() - layoutAnimationStart) / LAYOUT_ANIMATION_TIME, 1.0);
+    float ease = 1.0f - (1.0f - t) * (1.0f - t) * (1.0f - t);
+    for (size_t i = 0; i < layoutAnimationTo.size(); i++) {
+        const AINBImGuiNode::AuxInfo &from = layoutAnimationFrom[i];
+        AINBImGuiNode::AuxInfo auxInfo = layoutAnimationTo[i];
+        auxInfo.pos = Lerp(from.pos, auxInfo.pos, ease);
+        for (auto &[name, pos] : auxInfo.extraNodePos) {
+            auto it = from.extraNodePos.find(name);
+            if (it != from.extraNodePos.end()) {
+                pos = Lerp(it->second, pos, ease);
+            }
         }
-    };
+        newAuxInfos[auxInfo.nodeIdx] = std::move(auxInfo);
+    }
+    if (t >= 1.0f) {
+        layoutAnimationFrom.clear();
+        layoutAnimationTo.clear();
+    }
+}
+
+void AINBEditor::CancelLayout() {
+    layoutGeneration++;
+    layoutPending = false;
+    layoutAnimationFrom.clear();
+    layoutAnimationTo.clear();
+    forceLayout.reset();
+}
 
-    // First, try to place command root nodes
-    for (size_t i = 0; i < ainb->commands.size(); i++) {
-        placeNode(ainb->commands[i].rootNode->Idx(), {i, 0});
+void AINBEditor::StartForceLayout() {
+    CancelLayout();
+    std::vector<LayoutPos> positions;
+    forceLayoutApplied.clear();
+    for (const AINBImGuiNode &guiNode : guiNodes) {
+        ImVec2 pos = ed::GetNodePosition(guiNode.GetNodeID());
+        positions.push_back(GetLayoutPos(guiNode, pos));
+        forceLayoutApplied.push_back(pos);
     }
+    forceLayout = std::make_unique<ForceLayout>(MakeLayoutGraph(), std::move(positions), userPlacedNodes);
+}
 
-    // Place remaining orphan nodes
-    for (const AINB::Node &node : ainb->nodes) {
-        if (!idxToPos.contains(node.Idx())) {
-            placeNode(node.Idx(), {0, 0});
+void AINBEditor::StepForceLayout() {
+    if (forceLayout == nullptr) {
+        return;
+    }
+
+    // Nodes the user drags while the layout runs stay where they are dropped
+    for (size_t i = 0; i < guiNodes.size(); i++) {
+        ImVec2 pos = ed::GetNodePosition(guiNodes[i].GetNodeID());
+        if (pos.x != forceLayoutApplied[i].x || pos.y != forceLayoutApplied[i].y) {
+            userPlacedNodes[i] = true;
+            forceLayout->Pin(i, GetLayoutPos(guiNodes[i], pos));
+            forceLayoutApplied[i] = pos;
         }
     }
 
-    newAuxInfos.clear();
-    for (auto &[nodeIdx, coord] : idxToPos) {
-        AINBImGuiNode::AuxInfo auxInfo;
-        auxInfo.nodeIdx = nodeIdx;
-        auxInfo.pos = ImVec2(coord.first * 600, coord.second * 400);
+    // At least one step per frame, more if they are fast enough
+    auto start = std::chrono::steady_clock::now();
+    while (forceLayout->Step() && std::chrono::steady_clock::now() - start < std::chrono::milliseconds(FORCE_LAYOUT_FRAME_TIME)) {}
+
+    const std::vector<LayoutPos> &positions = forceLayout->GetPositions();
+    for (size_t i = 0; i < guiNodes.size(); i++) {
+        if (!userPlacedNodes[i]) {
+            AINBImGuiNode::AuxInfo auxInfo = MakeLayoutAuxInfo(guiNodes[i], positions[i]);
+            guiNodes[i].LoadAuxInfo(auxInfo);
+            // The node editor rounds positions down, compare against what it actually stored
+            forceLayoutApplied[i] = ed::GetNodePosition(guiNodes[i].GetNodeID());
+        }
+    }
+    if (forceLayout->IsConverged()) {
+        forceLayout.reset();
+    }
+}
 
-        int extraPinIdx = 0;
-        for (AINB::Param &param : ainb->nodes[nodeIdx].GetParams()) {
-            if (param.paramType == AINB::ParamType::Input) {
-                const AINB::InputParam &inputParam = static_cast<const AINB::InputParam &>(param);
-                if (inputParam.inputNodeIdxs.size() == 0) {
-                    auxInfo.extraNodePos[param.name] = ImVec2(auxInfo.pos.x - 250, auxInfo.pos.y + extraPinIdx * 70);
-                    extraPinIdx++;
-                }
+bool AINBEditor::SaveNodeSettings(ed::NodeId nodeId, const char *data, size_t size, ed::SaveReasonFlags reason, void *userPointer) {
+    AINBEditor *editor = static_cast<AINBEditor *>(userPointer);
+    ed::SaveReasonFlags userMove = ed::SaveReasonFlags::Position | ed::SaveReasonFlags::User;
+    if ((reason & userMove) == userMove) {
+        for (size_t i = 0; i < editor->guiNodes.size(); i++) {
+            if (editor->guiNodes[i].GetNodeID() == nodeId) {
+                editor->userPlacedNodes[i] = true;
+                break;
             }
         }
-        newAuxInfos[nodeIdx] = auxInfo;
     }
+    // Nothing is actually saved, this only tracks which nodes were placed by hand
+    return true;
 }
 
 void AINBEditor::SavePositionToFile(const std::vector<AINBImGuiNode::AuxInfo> &auxInfos) const {
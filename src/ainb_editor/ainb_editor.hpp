@@ -1,10 +1,16 @@
 #pragma once
 
+#include <atomic>
 #include <istream>
+#include <memory>
+#include <mutex>
 
 #include "ainb_node.hpp"
 #include "file_formats/ainb.hpp"
+#include "layout.hpp"
+#include "layout_cache.hpp"
 #include "node_editor/imgui_node_editor.h"
+#include "util/thread_pool.hpp"
 
 namespace ed = ax::NodeEditor;
 
@@ -24,18 +30,101 @@ private:
     size_t selectedNodeIdx = -1;
     std::string selectedCommand = "";
 
+    // Inspector node list, built once per AINB so that drawing only touches the visible rows
+    struct InspectorNode {
+        std::string title;
+        // Lowercase title, param and link names, matched against the filter
+        std::string searchText;
+    };
+    std::vector<InspectorNode> inspectorNodes;
+    std::vector<int> filteredNodes;
+    char nodeFilter[128] = "";
+    // Detail lines of the selected node, rebuilt when the selection or its values change
+    std::vector<std::string> nodeDetails;
+    size_t nodeDetailsIdx = -1;
+    u32 nodeDetailsEditCount = 0;
+
+    void PrepareInspector();
+    void FilterNodes();
+    void BuildNodeDetails(size_t nodeIdx);
+
+    // Auto layouts are computed on a worker thread from a snapshot of the graph.
+    // Requests are numbered, results of outdated ones (or of a previous AINB) are dropped.
+    std::atomic<u64> layoutGeneration = 0;
+    bool layoutPending = false;
+    std::mutex layoutMutex;
+    bool layoutReady = false;
+    u64 readyLayoutGeneration = 0;
+    std::vector<LayoutPos> readyLayout;
+
+    // Finished layouts are moved in over a short time
+    bool animateLayout = true;
+    double layoutAnimationStart = 0;
+    std::vector<AINBImGuiNode::AuxInfo> layoutAnimationFrom;
+    std::vector<AINBImGuiNode::AuxInfo> layoutAnimationTo;
+
+    // Force directed layout, stepped every frame until it converges. Nodes the user
+    // moved by hand are pinned in place.
+    std::unique_ptr<ForceLayout> forceLayout;
+    std::vector<bool> userPlacedNodes;
+    // Node positions set by the last step, to notice nodes the user moves during the layout
+    std::vector<ImVec2> forceLayoutApplied;
+
+    // Node positions are restored from and stored to the cache automatically
+    LayoutCache *layoutCache = nullptr;
+    u64 layoutKey = 0;
+    // Restored positions waiting for the next frame, in the order of StoreLayout
+    std::vector<LayoutPos> cachedPositions;
+
+    void RestoreLayout();
+    void ApplyCachedLayout();
+    void StoreLayout();
+
+    // Nodes to be placed again around their neighbours on the next frame
+    std::vector<u32> relayoutNodes;
+    void ApplyIncrementalLayout();
+
+    // View requested with SetView, applied at the start of the next frame
+    bool viewPending = false;
+    ImVec2 pendingViewCenter;
+    float pendingViewZoom = 0;
+    void ApplyView(ImVec2 canvasSize);
+
+    LayoutGraph MakeLayoutGraph() const;
+    AINBImGuiNode::AuxInfo MakeLayoutAuxInfo(const AINBImGuiNode &guiNode, LayoutPos pos) const;
+    LayoutPos GetLayoutPos(const AINBImGuiNode &guiNode, ImVec2 nodePos) const;
     void AutoLayout();
+    void ReceiveLayout();
+    void AnimateLayout();
+    void CancelLayout();
+    void StartForceLayout();
+    void StepForceLayout();
+    static bool SaveNodeSettings(ed::NodeId nodeId, const char *data, size_t size, ed::SaveReasonFlags reason, void *userPointer);
+
+    // Declared last, so that its worker is stopped before anything a job uses is destroyed
+    ThreadPool layoutPool { 1 };
 
 public:
     AINBEditor();
     ~AINBEditor();
 
-    void RegisterAINB(AINB &ainb);
+    // layoutKey identifies the AINB's entry in the layout cache
+    void RegisterAINB(AINB &ainb, u64 layoutKey);
     void UnloadAINB();
+    void SetLayoutCache(LayoutCache *cache);
+    // Places the given nodes (e.g. after they were added or relinked) next to their
+    // neighbours without moving any other node
+    void RelayoutNodes(const std::vector<u32> &nodeIdxs);
 
     void SavePositionToFile(const std::vector<AINBImGuiNode::AuxInfo> &auxInfos) const;
     void LoadPositionFromFile();
 
     void DrawInspector();
     void DrawNodeEditor();
+
+    // Whether the editor changes without any input, e.g. while a layout is computed or animated
+    bool IsBusy() const;
+    // Moves the view without animation. center is relative to the bounds of all nodes
+    // (0 to 1 on both axes), zoom is in pixels per canvas unit, 0 shows the whole graph.
+    void SetView(ImVec2 center, float zoom);
 };
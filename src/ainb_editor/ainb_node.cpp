@@ -4,11 +4,17 @@
 
 #include "node_editor/imgui_node_editor.h"
 #include "pin_icons.hpp"
+#include "util/profiler.hpp"
+
+// Zoom levels below which nodes are drawn simplified
+#define LOD_HEADER_SCALE 0.5f
+#define LOD_RECT_SCALE 0.2f
 
 u32 AINBImGuiNode::nextID = 0;
 
 AINBImGuiNode::AINBImGuiNode(AINB::Node &node) : node(node) {
     PreparePinIDs();
+    PrepareLabels();
     CalculateFrameWidth();
 }
 
@@ -37,7 +43,8 @@ void AINBImGuiNode::PreparePinIDs() {
                     .genNodePinID = MakePinID(),
                     .outputPinID = pinID,
                     .linkID = MakeLinkID(),
-                    .inputParam = inputParam
+                    .inputParam = inputParam,
+                    .defaultValueText = "(" + AINB::AINBValueToString(inputParam.defaultValue) + ")"
                 });
             } else {
                 for (size_t j = 0; j < inputParam.inputNodeIdxs.size(); j++) {
@@ -90,6 +97,55 @@ void AINBImGuiNode::PreparePinIDs() {
     }
 }
 
+std::string MakeTitle(const AINB::Node &node, const AINB::NodeLink &nl, int idx, int count) {
+    switch (node.type) {
+        case AINB::UserDefined:
+        case AINB::Element_BoolSelector:
+        case AINB::Element_SplitTiming:
+            return nl.name;
+        case AINB::Element_Simultaneous:
+            return "Control";
+        case AINB::Element_Sequential:
+            return "Seq " + std::to_string(idx);
+        case AINB::Element_S32Selector:
+        case AINB::Element_F32Selector:
+            if (idx == count - 1) {
+                return "Default";
+            }
+            return "=" + AINB::AINBValueToString(nl.value);
+        case AINB::Element_Fork:
+            return "Fork";
+        default:
+            return "<name unavailable>";
+    }
+}
+
+// Everything drawn as text is formatted once here, so that drawing doesn't allocate
+void AINBImGuiNode::PrepareLabels() {
+    for (size_t i = 0; i < flowLinks.size(); i++) {
+        flowLinks[i].title = MakeTitle(node, flowLinks[i].nodeLink, i, flowLinks.size());
+    }
+
+    const auto &params = node.GetParams();
+    for (int idx : inputPins) {
+        const AINB::Param &param = params[idx];
+        if (param.paramType != AINB::ParamType::Immediate) {
+            continue;
+        }
+        const AINB::ImmediateParam &immParam = static_cast<const AINB::ImmediateParam &>(param);
+        switch (immParam.dataType) {
+            case AINB::ValueType::Int:
+            case AINB::ValueType::Float:
+            case AINB::ValueType::Bool:
+            case AINB::ValueType::String:
+                break; // Drawn as input widgets
+            default:
+                immValueTexts[idx] = AINB::AINBValueToString(immParam.value);
+                break;
+        }
+    }
+}
+
 void AINBImGuiNode::CalculateFrameWidth() {
     int itemSpacingX = ImGui::GetStyle().ItemSpacing.x;
     frameWidth = 8 * 2 + ImGui::CalcTextSize(node.TypeName().c_str()).x + iconSize.x + itemSpacingX;
@@ -162,9 +218,9 @@ ImColor AINBImGuiNode::GetNodeHeaderColor(AINB::NodeType type) {
     }
 }
 
-void AINBImGuiNode::PrepareTextAlignRight(std::string str, int extraMargin) {
+void AINBImGuiNode::PrepareTextAlignRight(const char *str, int extraMargin) {
     int cursorPosX = HeaderMax.x;
-    cursorPosX -= 8 + ImGui::CalcTextSize(str.c_str()).x + extraMargin;
+    cursorPosX -= 8 + ImGui::CalcTextSize(str).x + extraMargin;
     ImGui::SetCursorPosX(cursorPosX);
 }
 
@@ -175,86 +231,77 @@ void AINBImGuiNode::DrawPinIcon(ed::PinId id, bool isOutput) {
     PinIcons::DrawIcon(iconSize);
     ed::EndPin();
     ed::PopStyleVar(2);
+
+    if (recordingLayout != nullptr) {
+        recordingLayout->pins.push_back(LODLayout::Pin {
+            id, isOutput, ImGui::GetItemRectMin() - recordingOrigin, ImGui::GetItemRectMax() - recordingOrigin
+        });
+    }
 }
 
 void AINBImGuiNode::DrawPinTextCommon(const AINB::Param &param) {
     ImGui::TextUnformatted(param.name.c_str());
 }
 
-void AINBImGuiNode::DrawInputPin(AINB::Param &param, ed::PinId id) {
+void AINBImGuiNode::DrawInputPin(AINB::Param &param, int paramIdx, ed::PinId id) {
     DrawPinIcon(id, false);
     ImGui::SameLine();
     DrawPinTextCommon(param);
     if (param.paramType == AINB::ParamType::Immediate) {
         AINB::ImmediateParam &immParam = static_cast<AINB::ImmediateParam &>(param);
         ImGui::SameLine();
+        // Widgets are identified by parameter index instead of a "##" + name label
+        ImGui::PushID(paramIdx);
         switch (immParam.dataType) {
             case AINB::ValueType::Int: {
                 ImGui::PushItemWidth(minImmTextboxWidth);
-                ImGui::InputScalar(("##" + param.name).c_str(), ImGuiDataType_U32, &std::get<u32>(immParam.value));
+                if (ImGui::InputScalar("##value", ImGuiDataType_U32, &std::get<u32>(immParam.value))) {
+                    editCount++;
+                }
                 ImGui::PopItemWidth();
                 break;
             }
             case AINB::ValueType::Float: {
                 ImGui::PushItemWidth(minImmTextboxWidth);
-                ImGui::InputScalar(("##" + param.name).c_str(), ImGuiDataType_Float, &std::get<float>(immParam.value));
+                if (ImGui::InputScalar("##value", ImGuiDataType_Float, &std::get<float>(immParam.value))) {
+                    editCount++;
+                }
                 ImGui::PopItemWidth();
                 break;
             }
             case AINB::ValueType::Bool:
-                ImGui::Checkbox(("##" + param.name).c_str(), &std::get<bool>(immParam.value));
+                if (ImGui::Checkbox("##value", &std::get<bool>(immParam.value))) {
+                    editCount++;
+                }
                 break;
             case AINB::ValueType::String: {
                 static char strBuf[256];
                 strncpy(strBuf, std::get<std::string>(immParam.value).c_str(), 256);
                 ImGui::PushItemWidth(minImmTextboxWidth);
-                ImGui::InputText(("##" + param.name).c_str(), strBuf, 256);
+                ImGui::InputText("##value", strBuf, 256);
                 ImGui::PopItemWidth();
                 break;
             }
             default:
-                ImGui::Text("%s", AINB::AINBValueToString(immParam.value).c_str());
+                ImGui::TextUnformatted(immValueTexts.at(paramIdx).c_str());
                 break;
         }
+        ImGui::PopID();
     }
 }
 
 void AINBImGuiNode::DrawOutputPin(const AINB::Param &param, ed::PinId id) {
-    PrepareTextAlignRight(param.name, iconSize.x + ImGui::GetStyle().ItemSpacing.x);
+    PrepareTextAlignRight(param.name.c_str(), iconSize.x + ImGui::GetStyle().ItemSpacing.x);
     DrawPinTextCommon(param);
     ImGui::SameLine();
     DrawPinIcon(id, true);
 }
 
-std::string MakeTitle(const AINB::Node &node, const AINB::NodeLink &nl, int idx, int count) {
-    switch (node.type) {
-        case AINB::UserDefined:
-        case AINB::Element_BoolSelector:
-        case AINB::Element_SplitTiming:
-            return nl.name;
-        case AINB::Element_Simultaneous:
-            return "Control";
-        case AINB::Element_Sequential:
-            return "Seq " + std::to_string(idx);
-        case AINB::Element_S32Selector:
-        case AINB::Element_F32Selector:
-            if (idx == count - 1) {
-                return "Default";
-            }
-            return "=" + AINB::AINBValueToString(nl.value);
-        case AINB::Element_Fork:
-            return "Fork";
-        default:
-            return "<name unavailable>";
-    }
-}
-
 void AINBImGuiNode::DrawExtraPins() {
     for (size_t i = 0; i < flowLinks.size(); i++) {
         const FlowLink &flowLink = flowLinks[i];
-        std::string title = MakeTitle(node, flowLink.nodeLink, i, flowLinks.size());
-        PrepareTextAlignRight(title, iconSize.x + ImGui::GetStyle().ItemSpacing.x);
-        ImGui::TextUnformatted(title.c_str());
+        PrepareTextAlignRight(flowLink.title.c_str(), iconSize.x + ImGui::GetStyle().ItemSpacing.x);
+        ImGui::TextUnformatted(flowLink.title.c_str());
         ImGui::SameLine();
         DrawPinIcon(extraPins[i], true);
         if (node.type == AINB::Element_Simultaneous || node.type == AINB::Element_Fork) {
@@ -263,34 +310,131 @@ void AINBImGuiNode::DrawExtraPins() {
     }
 }
 
-void AINBImGuiNode::Draw() {
-    ed::PushStyleVar(ed::StyleVar_NodePadding, ImVec4(8, 8, 8, 8));
-    ed::BeginNode(nodeID);
+void AINBImGuiNode::BeginLayoutRecording(LODLayout &layout, ed::NodeId id) {
+    layout.pins.clear();
+    recordingLayout = &layout;
+    recordingOrigin = ed::GetNodePosition(id);
+}
+
+void AINBImGuiNode::EndLayoutRecording(ed::NodeId id) {
+    recordingLayout->size = ed::GetNodeSize(id);
+    recordingLayout->valid = true;
+    recordingLayout = nullptr;
+}
+
+AINBImGuiNode::LODLevel AINBImGuiNode::GetLODLevel() {
+    float scale = 1.0f / ed::GetCurrentZoom();
+    if (scale < LOD_RECT_SCALE) {
+        return LODLevel::Rect;
+    }
+    if (scale < LOD_HEADER_SCALE) {
+        return LODLevel::Header;
+    }
+    return LODLevel::Full;
+}
+
+void AINBImGuiNode::DrawSimplified(ed::NodeId id, const LODLayout &layout, const char *title, LODLevel lod, ImColor rectColor) {
+    if (lod == LODLevel::Rect) {
+        ed::PushStyleColor(ed::StyleColor_NodeBg, rectColor);
+        ed::PushStyleVar(ed::StyleVar_LinkStrength, 0.0f);
+    }
+    ed::PushStyleVar(ed::StyleVar_NodePadding, ImVec4(0, 0, 0, 0));
+    ed::BeginNode(id);
+        ImVec2 origin = ImGui::GetCursorScreenPos();
+
+        // Pins are only needed as link endpoints, so they get their old rects without any content
         ed::PushStyleVar(ed::StyleVar_PivotAlignment, ImVec2(0.5f, 1.0f));
         ed::PushStyleVar(ed::StyleVar_PivotSize, ImVec2(0, 0));
-        ed::BeginPin(flowPinID, ed::PinKind::Input);
-        PinIcons::DrawIcon(iconSize);
-        ed::EndPin();
+        for (const LODLayout::Pin &pin : layout.pins) {
+            ed::BeginPin(pin.id, pin.isOutput ? ed::PinKind::Output : ed::PinKind::Input);
+            ed::PinRect(origin + pin.min, origin + pin.max);
+            ed::EndPin();
+        }
+        ed::PopStyleVar(2);
+
+        if (lod == LODLevel::Header) {
+            ImGui::SetCursorScreenPos(origin + layout.titlePos);
+            ImGui::TextUnformatted(title);
+        }
+        ImGui::SetCursorScreenPos(origin);
+        ImGui::Dummy(layout.size);
+    ed::EndNode();
+    if (lod == LODLevel::Rect) {
         ed::PopStyleVar(2);
+        ed::PopStyleColor();
+    } else {
+        ed::PopStyleVar();
+    }
+}
+
+void AINBImGuiNode::DrawHeader(ImVec2 headerMin, ImVec2 headerMax) {
+    int alpha = ImGui::GetStyle().Alpha;
+    ImColor headerColor = GetNodeHeaderColor(node.type);
+    headerColor.Value.w = alpha;
+
+    ImDrawList *drawList = ed::GetNodeBackgroundDrawList(nodeID);
+
+    const auto borderWidth = ed::GetStyle().NodeBorderWidth;
+
+    headerMin.x += borderWidth;
+    headerMin.y += borderWidth;
+    headerMax.x -= borderWidth;
+    headerMax.y -= borderWidth;
+
+    drawList->AddRectFilled(headerMin, headerMax, headerColor, ed::GetStyle().NodeRounding,
+        ImDrawFlags_RoundCornersTopLeft | ImDrawFlags_RoundCornersTopRight);
+
+    ImVec2 headerSeparatorLeft = ImVec2(headerMin.x - borderWidth / 2, headerMax.y - 0.5f);
+    ImVec2 headerSeparatorRight = ImVec2(headerMax.x, headerMax.y - 0.5f);
+
+    drawList->AddLine(headerSeparatorLeft, headerSeparatorRight, ImColor(255, 255, 255, (int) (alpha * 255 / 2)), borderWidth);
+}
+
+void AINBImGuiNode::Draw() {
+    AINBY_PROFILE_SCOPE("AINBImGuiNode::Draw");
+    if (!ed::IsNodeInView(nodeID)) {
+        ed::SkipNode(nodeID);
+        return;
+    }
+
+    LODLevel lod = GetLODLevel();
+    if (lod != LODLevel::Full && layout.valid) {
+        DrawSimplified(nodeID, layout, node.TypeName().c_str(), lod, GetNodeHeaderColor(node.type));
+        if (lod == LODLevel::Header && ImGui::IsItemVisible()) {
+            ImVec2 origin = ed::GetNodePosition(nodeID);
+            DrawHeader(origin + layout.headerMin, origin + layout.headerMax);
+        }
+        return;
+    }
+
+    ed::PushStyleVar(ed::StyleVar_NodePadding, ImVec4(8, 8, 8, 8));
+    ed::BeginNode(nodeID);
+        BeginLayoutRecording(layout, nodeID);
+
+        DrawPinIcon(flowPinID, false);
 
         ImGui::SameLine();
-        ImGui::Text("%s", node.TypeName().c_str());
+        ImGui::TextUnformatted(node.TypeName().c_str());
+        layout.titlePos = ImGui::GetItemRectMin() - recordingOrigin;
 
         HeaderMin = ImGui::GetItemRectMin() - ImVec2(iconSize.x + ImGui::GetStyle().ItemSpacing.x + 8, 8);
         HeaderMax = ImVec2(HeaderMin.x + frameWidth, ImGui::GetItemRectMax().y + 8);
+        layout.headerMin = HeaderMin - recordingOrigin;
+        layout.headerMax = HeaderMax - recordingOrigin;
 
         ImGui::Dummy(ImVec2(0, 8));
 
         // Main content frame
+        const auto &params = node.GetParams();
         for (size_t i = 0; i < inputPins.size() || i < outputPins.size(); i++) {
             if (i < inputPins.size()) {
-                DrawInputPin(node.GetParams()[inputPins[i]], idxToID[inputPins[i]]);
+                DrawInputPin(params[inputPins[i]], inputPins[i], idxToID[inputPins[i]]);
             } else {
                 ImGui::Dummy(ImVec2(0, 0));
             }
             ImGui::SameLine();
             if (i < outputPins.size()) {
-                DrawOutputPin(node.GetParams()[outputPins[i]], idxToID[outputPins[i]]);
+                DrawOutputPin(params[outputPins[i]], idxToID[outputPins[i]]);
             } else {
                 ImGui::Dummy(ImVec2(0, 0));
             }
@@ -298,41 +442,39 @@ void AINBImGuiNode::Draw() {
         DrawExtraPins();
     ed::EndNode();
     ed::PopStyleVar();
+    EndLayoutRecording(nodeID);
 
     if (ImGui::IsItemVisible()) {
-        int alpha = ImGui::GetStyle().Alpha;
-        ImColor headerColor = GetNodeHeaderColor(node.type);
-        headerColor.Value.w = alpha;
-
-        ImDrawList *drawList = ed::GetNodeBackgroundDrawList(nodeID);
-
-        const auto borderWidth = ed::GetStyle().NodeBorderWidth;
-
-        HeaderMin.x += borderWidth;
-        HeaderMin.y += borderWidth;
-        HeaderMax.x -= borderWidth;
-        HeaderMax.y -= borderWidth;
-
-        drawList->AddRectFilled(HeaderMin, HeaderMax, headerColor, ed::GetStyle().NodeRounding,
-            ImDrawFlags_RoundCornersTopLeft | ImDrawFlags_RoundCornersTopRight);
-
-        ImVec2 headerSeparatorLeft = ImVec2(HeaderMin.x - borderWidth / 2, HeaderMax.y - 0.5f);
-        ImVec2 headerSeparatorRight = ImVec2(HeaderMax.x, HeaderMax.y - 0.5f);
-
-        drawList->AddLine(headerSeparatorLeft, headerSeparatorRight, ImColor(255, 255, 255, (int) (alpha * 255 / 2)), borderWidth);
+        DrawHeader(HeaderMin, HeaderMax);
     }
 }
 
 void AINBImGuiNode::DrawLinks(std::vector<AINBImGuiNode> &nodes) {
+    AINBY_PROFILE_SCOPE("AINBImGuiNode::DrawLinks");
     // Draw inputs not connected to a node
-    for (const NonNodeInput &input : nonNodeInputs) {
+    LODLevel lod = GetLODLevel();
+    for (NonNodeInput &input : nonNodeInputs) {
+        if (!ed::IsNodeInView(input.genNodeID)) {
+            ed::SkipNode(input.genNodeID);
+            ed::Link(input.linkID, input.genNodePinID, input.outputPinID, ImColor(255, 255, 255));
+            continue;
+        }
+
         const AINB::InputParam &inputParam = input.inputParam;
         ed::PushStyleColor(ed::StyleColor_NodeBg, ImColor(32, 117, 21, 192));
+        if (lod != LODLevel::Full && input.layout.valid) {
+            DrawSimplified(input.genNodeID, input.layout, inputParam.name.c_str(), lod, ImColor(32, 117, 21, 192));
+            ed::PopStyleColor();
+            ed::Link(input.linkID, input.genNodePinID, input.outputPinID, ImColor(255, 255, 255));
+            continue;
+        }
         ed::BeginNode(input.genNodeID);
-            std::string titleStr = inputParam.name;
-            std::string defaultValueStr = "(" + AINB::AINBValueToString(inputParam.defaultValue) + ")";
+            BeginLayoutRecording(input.layout, input.genNodeID);
+            const std::string &titleStr = inputParam.name;
+            const std::string &defaultValueStr = input.defaultValueText;
 
             ImGui::TextUnformatted(titleStr.c_str());
+            input.layout.titlePos = ImGui::GetItemRectMin() - recordingOrigin;
             int titleSizeX = ImGui::CalcTextSize(titleStr.c_str()).x;
             int defaultValueSizeX = ImGui::CalcTextSize(defaultValueStr.c_str()).x + ImGui::GetStyle().ItemSpacing.x + iconSize.x;
             if (defaultValueSizeX < titleSizeX) {
@@ -341,13 +483,9 @@ void AINBImGuiNode::DrawLinks(std::vector<AINBImGuiNode> &nodes) {
             }
             ImGui::TextUnformatted(defaultValueStr.c_str());
             ImGui::SameLine();
-            ed::PushStyleVar(ed::StyleVar_PivotAlignment, ImVec2(0.5f, 1.0f));
-            ed::PushStyleVar(ed::StyleVar_PivotSize, ImVec2(0, 0));
-            ed::BeginPin(input.genNodePinID, ed::PinKind::Output);
-            PinIcons::DrawIcon(iconSize);
-            ed::EndPin();
-            ed::PopStyleVar(2);
+            DrawPinIcon(input.genNodePinID, true);
         ed::EndNode();
+        EndLayoutRecording(input.genNodeID);
         ed::PopStyleColor();
 
         ed::Link(input.linkID, input.genNodePinID, input.outputPinID, ImColor(255, 255, 255));
@@ -371,6 +509,19 @@ void AINBImGuiNode::DrawLinks(std::vector<AINBImGuiNode> &nodes) {
     }
 }
 
+ImVec2 AINBImGuiNode::GetSize() const {
+    if (layout.valid) {
+        return layout.size;
+    }
+    size_t flowRowCount = flowLinks.size();
+    if (node.type == AINB::Element_Simultaneous || node.type == AINB::Element_Fork) {
+        flowRowCount = std::min(flowRowCount, (size_t) 1); // See DrawExtraPins
+    }
+    size_t rowCount = std::max(inputPins.size(), outputPins.size()) + flowRowCount;
+    // Padding, header and the spacing below it, then one row per pin
+    return ImVec2(frameWidth, 8 * 3 + (rowCount + 1) * ImGui::GetFrameHeightWithSpacing());
+}
+
 AINBImGuiNode::AuxInfo AINBImGuiNode::GetAuxInfo() const {
     AuxInfo auxInfo;
     auxInfo.nodeIdx = node.Idx();
@@ -14,17 +14,41 @@ namespace ed = ax::NodeEditor;
 
 class AINBImGuiNode {
 public:
+    enum class LODLevel {
+        Full,
+        Header, // Header bar with the title only
+        Rect    // Solid colored rectangle with straight links
+    };
+    // Node contents as of the last full draw, so that simplified nodes can keep
+    // the same size and pin positions. Positions are relative to the node.
+    struct LODLayout {
+        struct Pin {
+            ed::PinId id;
+            bool isOutput;
+            ImVec2 min;
+            ImVec2 max;
+        };
+        bool valid = false;
+        ImVec2 size;
+        ImVec2 titlePos;
+        ImVec2 headerMin;
+        ImVec2 headerMax;
+        std::vector<Pin> pins;
+    };
     struct NonNodeInput {
         ed::NodeId genNodeID;
         ed::PinId genNodePinID;
         ed::PinId outputPinID;
         ed::LinkId linkID;
         AINB::InputParam &inputParam;
+        std::string defaultValueText;
+        LODLayout layout;
     };
     struct FlowLink {
         ed::LinkId linkID;
         ed::PinId flowFromPinID;
         AINB::NodeLink nodeLink;
+        std::string title;
     };
     struct ParamLink {
         ed::LinkId linkID;
@@ -48,6 +72,10 @@ public:
     ed::NodeId GetNodeID() const { return nodeID; }
     const AINB::Node &GetNode() const { return node; }
     const std::vector<NonNodeInput> &GetNonNodeInputs() const { return nonNodeInputs; }
+    // Size as of the last full draw, or an estimate if the node was never drawn
+    ImVec2 GetSize() const;
+    // Incremented whenever an immediate value is changed through the node's widgets
+    u32 GetEditCount() const { return editCount; }
 
     AuxInfo GetAuxInfo() const;
     void LoadAuxInfo(const AuxInfo &auxInfo);
@@ -61,6 +89,9 @@ private:
 
     ed::NodeId nodeID;
     ed::PinId flowPinID;
+    LODLayout layout;
+    LODLayout *recordingLayout = nullptr;
+    ImVec2 recordingOrigin;
     std::vector<int> inputPins;
     std::vector<int> outputPins;
     std::vector<ed::PinId> extraPins;
@@ -72,6 +103,9 @@ private:
 
     std::unordered_map<std::string, ed::PinId> nameToPinID;
     std::unordered_map<int, ed::PinId> idxToID;
+    // Text of immediate values that have no input widget, by param index
+    std::unordered_map<int, std::string> immValueTexts;
+    u32 editCount = 0;
 
     ImVec2 iconSize = ImVec2(10, 10);
     const int minImmTextboxWidth = 150;
@@ -83,12 +117,19 @@ private:
 
     void DrawPinIcon(ed::PinId id, bool isOutput);
     void DrawPinTextCommon(const AINB::Param &param);
-    void DrawInputPin(AINB::Param &param, ed::PinId id);
+    void DrawInputPin(AINB::Param &param, int paramIdx, ed::PinId id);
     void DrawOutputPin(const AINB::Param &param, ed::PinId id);
     void DrawExtraPins();
+    void DrawHeader(ImVec2 headerMin, ImVec2 headerMax);
+    void DrawSimplified(ed::NodeId id, const LODLayout &layout, const char *title, LODLevel lod, ImColor rectColor);
+
+    void BeginLayoutRecording(LODLayout &layout, ed::NodeId id);
+    void EndLayoutRecording(ed::NodeId id);
+    static LODLevel GetLODLevel();
 
     void PreparePinIDs();
+    void PrepareLabels();
     void CalculateFrameWidth();
     static ImColor GetNodeHeaderColor(AINB::NodeType type);
-    void PrepareTextAlignRight(std::string str, int extraMargin = 0);
+    void PrepareTextAlignRight(const char *str, int extraMargin = 0);
 };
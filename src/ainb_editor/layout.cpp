@@ -0,0 +1,899 @@
+#include "layout.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <numeric>
+#include <span>
+
+#include "util/profiler.hpp"
+
+// Horizontal space between layers, leaves room for the links
+#define LAYER_GAP 150.0f
+// Vertical space between nodes of the same layer
+#define NODE_GAP 40.0f
+// Vertical space next to a long edge passing through a layer
+#define DUMMY_GAP 20.0f
+// Space between the laid out components
+#define COMPONENT_GAP 300.0f
+// Limits the dummy vertices inserted for long edges
+#define DUMMIES_PER_NODE 4
+
+// Barnes-Hut accuracy: cells that appear smaller than this (size / distance) are
+// approximated by their center of mass
+#define FORCE_THETA 0.8f
+#define FORCE_MAX_DEPTH 32
+// Pull of the horizontal flow, which keeps links going left to right
+#define FORCE_FLOW_STRENGTH 0.5f
+// Keeps unconnected parts from drifting apart
+#define FORCE_GRAVITY 0.01f
+// The maximum movement per step starts at this many ideal distances and decays
+#define FORCE_START_TEMPERATURE 4.0f
+#define FORCE_COOLING 0.97f
+#define FORCE_MIN_MOVEMENT 0.5f
+#define CROSSING_SWEEPS 12
+#define COORDINATE_SWEEPS 8
+
+namespace {
+
+// Adjacency lists stored in one array: the neighbours of node i are
+// targets[start[i]] up to targets[start[i + 1]]
+struct Adjacency {
+    std::vector<u32> start;
+    std::vector<u32> targets;
+
+    void Build(u32 nodeCount, const std::vector<std::pair<u32, u32>> &edges, bool reverse) {
+        start.assign(nodeCount + 1, 0);
+        for (const auto &[from, to] : edges) {
+            start[(reverse ? to : from) + 1]++;
+        }
+        for (u32 i = 0; i < nodeCount; i++) {
+            start[i + 1] += start[i];
+        }
+        targets.resize(edges.size());
+        std::vector<u32> fill(start.begin(), start.end() - 1);
+        for (const auto &[from, to] : edges) {
+            if (reverse) {
+                targets[fill[to]++] = from;
+            } else {
+                targets[fill[from]++] = to;
+            }
+        }
+    }
+
+    std::span<const u32> operator[](u32 node) const {
+        return std::span<const u32>(targets.data() + start[node], start[node + 1] - start[node]);
+    }
+};
+
+void RemoveDuplicateEdges(std::vector<std::pair<u32, u32>> &edges) {
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+}
+
+// Lays out one connected component. Long edges are split into chains of dummy
+// vertices (one per layer they pass through), which are ordered and placed just
+// like nodes, so that they keep out of the way of other nodes.
+class ComponentLayout {
+public:
+    // The first rootCount nodes are command roots
+    ComponentLayout(const std::vector<LayoutGraph::Node> &sizes, std::vector<std::pair<u32, u32>> edges, u32 rootCount)
+        : sizes(sizes), nodeCount(sizes.size()), rootCount(rootCount), edges(std::move(edges)) {}
+
+    // Returns the size of the component
+    LayoutPos Run(std::vector<LayoutPos> &positions) {
+        AINBY_PROFILE_SCOPE("ComponentLayout::Run");
+        BreakCycles();
+        AssignLayers();
+        InsertDummies();
+        InitialOrder();
+        {
+            AINBY_PROFILE_SCOPE("ComponentLayout::MinimizeCrossings");
+            MinimizeCrossings();
+        }
+        AINBY_PROFILE_SCOPE("ComponentLayout::AssignCoordinates");
+        return AssignCoordinates(positions);
+    }
+
+private:
+    bool IsDummy(u32 v) const { return v >= nodeCount; }
+
+    // Reverses the edges that close a cycle in a depth first search
+    void BreakCycles() {
+        Adjacency succs;
+        succs.Build(nodeCount, edges, false);
+
+        std::vector<std::pair<u32, u32>> dagEdges;
+        dagEdges.reserve(edges.size());
+        std::vector<u8> state(nodeCount, 0); // 0: new, 1: on the stack, 2: done
+        std::vector<std::pair<u32, u32>> stack; // Node and index of its next edge
+        for (u32 start = 0; start < nodeCount; start++) {
+            if (state[start] != 0) {
+                continue;
+            }
+            state[start] = 1;
+            stack.push_back({ start, 0 });
+            while (!stack.empty()) {
+                auto &[u, next] = stack.back();
+                std::span<const u32> out = succs[u];
+                if (next == out.size()) {
+                    state[u] = 2;
+                    stack.pop_back();
+                    continue;
+                }
+                u32 v = out[next++];
+                if (state[v] == 1) {
+                    dagEdges.push_back({ v, u });
+                    continue;
+                }
+                dagEdges.push_back({ u, v });
+                if (state[v] == 0) {
+                    state[v] = 1;
+                    stack.push_back({ v, 0 });
+                }
+            }
+        }
+        edges = std::move(dagEdges);
+        RemoveDuplicateEdges(edges);
+    }
+
+    // Longest path layering, after which sources (such as nodes only providing
+    // inputs) are moved right next to their leftmost successor
+    void AssignLayers() {
+        Adjacency preds, succs;
+        preds.Build(nodeCount, edges, true);
+        succs.Build(nodeCount, edges, false);
+
+        std::vector<u32> inDegree(nodeCount);
+        std::vector<u32> order;
+        order.reserve(nodeCount);
+        for (u32 v = 0; v < nodeCount; v++) {
+            inDegree[v] = preds[v].size();
+            if (inDegree[v] == 0) {
+                order.push_back(v);
+            }
+        }
+        layer.assign(nodeCount, 0);
+        for (size_t i = 0; i < order.size(); i++) {
+            u32 u = order[i];
+            for (u32 v : succs[u]) {
+                layer[v] = std::max(layer[v], layer[u] + 1);
+                if (--inDegree[v] == 0) {
+                    order.push_back(v);
+                }
+            }
+        }
+
+        for (size_t i = order.size(); i-- > 0;) {
+            u32 v = order[i];
+            if (v < rootCount || !preds[v].empty() || succs[v].empty()) {
+                continue;
+            }
+            u32 minLayer = UINT32_MAX;
+            for (u32 succ : succs[v]) {
+                minLayer = std::min(minLayer, layer[succ]);
+            }
+            layer[v] = minLayer - 1;
+        }
+    }
+
+    // Long edges crossing many layers would need a lot of dummies, so past a budget
+    // the longest ones are kept as direct edges. Those still pull their ends together,
+    // but are ignored when counting crossings.
+    void InsertDummies() {
+        std::sort(edges.begin(), edges.end(), [&](const std::pair<u32, u32> &a, const std::pair<u32, u32> &b) {
+            return layer[a.second] - layer[a.first] < layer[b.second] - layer[b.first];
+        });
+        u32 dummyBudget = nodeCount * DUMMIES_PER_NODE;
+
+        std::vector<std::pair<u32, u32>> layerEdges;
+        layerEdges.reserve(edges.size());
+        for (const auto &[from, to] : edges) {
+            u32 dummyCount = layer[to] - layer[from] - 1;
+            if (dummyCount > dummyBudget) {
+                layerEdges.push_back({ from, to });
+                continue;
+            }
+            dummyBudget -= dummyCount;
+            u32 prev = from;
+            for (u32 l = layer[from] + 1; l < layer[to]; l++) {
+                u32 dummy = layer.size();
+                layer.push_back(l);
+                layerEdges.push_back({ prev, dummy });
+                prev = dummy;
+            }
+            layerEdges.push_back({ prev, to });
+        }
+        vertexCount = layer.size();
+        preds.Build(vertexCount, layerEdges, true);
+        succs.Build(vertexCount, layerEdges, false);
+
+        layerCount = *std::max_element(layer.begin(), layer.end()) + 1;
+    }
+
+    // Orders every layer by depth first search preorder, which already keeps
+    // subtrees together
+    void InitialOrder() {
+        layers.assign(layerCount, {});
+        order.assign(vertexCount, 0);
+        std::vector<bool> visited(vertexCount, false);
+        std::vector<u32> stack;
+        for (u32 start = 0; start < vertexCount; start++) {
+            stack.push_back(start);
+            while (!stack.empty()) {
+                u32 v = stack.back();
+                stack.pop_back();
+                if (visited[v]) {
+                    continue;
+                }
+                visited[v] = true;
+                order[v] = layers[layer[v]].size();
+                layers[layer[v]].push_back(v);
+                std::span<const u32> out = succs[v];
+                for (size_t i = out.size(); i-- > 0;) {
+                    if (!visited[out[i]]) {
+                        stack.push_back(out[i]);
+                    }
+                }
+            }
+        }
+    }
+
+    // Barycenter heuristic, alternating between downward and upward sweeps.
+    // The ordering with the fewest crossings seen is kept.
+    void MinimizeCrossings() {
+        u64 bestCrossings = CountCrossings();
+        std::vector<std::vector<u32>> bestLayers = layers;
+        std::vector<f32> keys(vertexCount);
+
+        for (int sweep = 0; sweep < CROSSING_SWEEPS && bestCrossings > 0; sweep++) {
+            bool down = sweep % 2 == 0;
+            const Adjacency &neighbours = down ? preds : succs;
+            for (u32 i = 1; i < layerCount; i++) {
+                std::vector<u32> &current = layers[down ? i : layerCount - 1 - i];
+                for (u32 v : current) {
+                    std::span<const u32> adjacent = neighbours[v];
+                    if (adjacent.empty()) {
+                        keys[v] = order[v];
+                        continue;
+                    }
+                    f32 sum = 0;
+                    for (u32 n : adjacent) {
+                        sum += order[n];
+                    }
+                    keys[v] = sum / adjacent.size();
+                }
+                std::stable_sort(current.begin(), current.end(), [&](u32 a, u32 b) {
+                    return keys[a] < keys[b];
+                });
+                for (u32 j = 0; j < current.size(); j++) {
+                    order[current[j]] = j;
+                }
+            }
+
+            u64 crossings = CountCrossings();
+            if (crossings < bestCrossings) {
+                bestCrossings = crossings;
+                bestLayers = layers;
+            }
+        }
+
+        layers = std::move(bestLayers);
+        for (const std::vector<u32> &current : layers) {
+            for (u32 j = 0; j < current.size(); j++) {
+                order[current[j]] = j;
+            }
+        }
+    }
+
+    // Edge crossings between adjacent layers, counted as inversions with a Fenwick tree
+    u64 CountCrossings() {
+        u64 crossings = 0;
+        std::vector<u32> targets;
+        for (u32 l = 0; l + 1 < layerCount; l++) {
+            fenwick.assign(layers[l + 1].size() + 1, 0);
+            u32 inserted = 0;
+            for (u32 u : layers[l]) {
+                targets.clear();
+                for (u32 v : succs[u]) {
+                    if (layer[v] == l + 1) {
+                        targets.push_back(order[v]);
+                    }
+                }
+                std::sort(targets.begin(), targets.end());
+                for (u32 target : targets) {
+                    u32 notAbove = 0;
+                    for (u32 i = target + 1; i > 0; i -= i & -i) {
+                        notAbove += fenwick[i];
+                    }
+                    crossings += inserted - notAbove;
+                    for (u32 i = target + 1; i < fenwick.size(); i += i & -i) {
+                        fenwick[i]++;
+                    }
+                    inserted++;
+                }
+            }
+        }
+        return crossings;
+    }
+
+    f32 Height(u32 v) const { return IsDummy(v) ? 0 : sizes[v].height; }
+
+    f32 Gap(u32 a, u32 b) const { return IsDummy(a) || IsDummy(b) ? DUMMY_GAP : NODE_GAP; }
+
+    // Moves the vertices of a layer as close to their desired tops as possible while
+    // keeping their order and spacing. Subtracting the minimum offset of every vertex
+    // turns the spacing into a plain ordering constraint, which makes this an isotonic
+    // regression solved by pooling adjacent violators.
+    void PlaceLayer(const std::vector<u32> &current, const std::vector<f32> &desired, const std::vector<f32> &weights) {
+        blocks.clear();
+        offsets.resize(current.size());
+        f32 offset = 0;
+        for (size_t i = 0; i < current.size(); i++) {
+            u32 v = current[i];
+            offsets[i] = offset;
+            blocks.push_back({ (desired[v] - offset) * weights[v], weights[v], 1 });
+            while (blocks.size() > 1 && blocks[blocks.size() - 2].Mean() >= blocks.back().Mean()) {
+                Block last = blocks.back();
+                blocks.pop_back();
+                blocks.back().weightedSum += last.weightedSum;
+                blocks.back().weight += last.weight;
+                blocks.back().count += last.count;
+            }
+            if (i + 1 < current.size()) {
+                offset += Height(v) + Gap(v, current[i + 1]);
+            }
+        }
+        size_t i = 0;
+        for (const Block &block : blocks) {
+            f32 mean = block.Mean();
+            for (u32 k = 0; k < block.count; k++, i++) {
+                top[current[i]] = mean + offsets[i];
+            }
+        }
+    }
+
+    LayoutPos AssignCoordinates(std::vector<LayoutPos> &positions) {
+        std::vector<f32> layerX(layerCount, 0);
+        f32 x = 0;
+        for (u32 l = 0; l < layerCount; l++) {
+            f32 layerWidth = 0;
+            for (u32 v : layers[l]) {
+                if (!IsDummy(v)) {
+                    layerWidth = std::max(layerWidth, sizes[v].width);
+                }
+            }
+            layerX[l] = x;
+            x += layerWidth + LAYER_GAP;
+        }
+
+        top.assign(vertexCount, 0);
+        for (const std::vector<u32> &current : layers) {
+            f32 y = 0;
+            for (size_t i = 0; i < current.size(); i++) {
+                top[current[i]] = y;
+                if (i + 1 < current.size()) {
+                    y += Height(current[i]) + Gap(current[i], current[i + 1]);
+                }
+            }
+        }
+
+        // Every vertex is pulled towards the mean center of its neighbours in the
+        // previous (or next) layer, vertices without any just keep their place
+        std::vector<f32> desired(vertexCount);
+        std::vector<f32> weights(vertexCount);
+        for (int sweep = 0; sweep < COORDINATE_SWEEPS; sweep++) {
+            bool down = sweep % 2 == 0;
+            const Adjacency &neighbours = down ? preds : succs;
+            for (u32 i = 1; i < layerCount; i++) {
+                const std::vector<u32> &current = layers[down ? i : layerCount - 1 - i];
+                for (u32 v : current) {
+                    std::span<const u32> adjacent = neighbours[v];
+                    if (adjacent.empty()) {
+                        desired[v] = top[v];
+                        weights[v] = 0.25f;
+                        continue;
+                    }
+                    f32 sum = 0;
+                    for (u32 n : adjacent) {
+                        sum += top[n] + Height(n) / 2;
+                    }
+                    desired[v] = sum / adjacent.size() - Height(v) / 2;
+                    weights[v] = adjacent.size();
+                }
+                PlaceLayer(current, desired, weights);
+            }
+        }
+
+        f32 minY = *std::min_element(top.begin(), top.end());
+        LayoutPos size = { 0, 0 };
+        positions.resize(nodeCount);
+        for (u32 v = 0; v < vertexCount; v++) {
+            f32 y = top[v] - minY;
+            size.y = std::max(size.y, y + Height(v));
+            if (!IsDummy(v)) {
+                positions[v] = { layerX[layer[v]], y };
+                size.x = std::max(size.x, layerX[layer[v]] + sizes[v].width);
+            }
+        }
+        return size;
+    }
+
+    const std::vector<LayoutGraph::Node> &sizes;
+    u32 nodeCount;
+    u32 rootCount;
+    std::vector<std::pair<u32, u32>> edges;
+
+    // Indexed by vertex, which are the nodes followed by the dummies
+    u32 vertexCount = 0;
+    std::vector<u32> layer;
+    std::vector<u32> order;
+    std::vector<f32> top;
+    Adjacency preds;
+    Adjacency succs;
+
+    u32 layerCount = 0;
+    std::vector<std::vector<u32>> layers;
+
+    // Scratch buffers
+    struct Block {
+        f32 weightedSum;
+        f32 weight;
+        u32 count;
+        f32 Mean() const { return weightedSum / weight; }
+    };
+    std::vector<Block> blocks;
+    std::vector<f32> offsets;
+    std::vector<u32> fenwick;
+};
+
+u32 FindComponent(std::vector<u32> &parent, u32 v) {
+    while (parent[v] != v) {
+        parent[v] = parent[parent[v]];
+        v = parent[v];
+    }
+    return v;
+}
+
+// Returns the free top coordinate closest to desired. Every (start, end) range is
+// blocked, a top exactly on its start or end is still fine.
+f32 FindFreeTop(std::vector<std::pair<f32, f32>> &blocked, f32 desired) {
+    std::sort(blocked.begin(), blocked.end());
+    size_t i = 0;
+    while (i < blocked.size()) {
+        f32 start = blocked[i].first;
+        f32 end = blocked[i].second;
+        for (i++; i < blocked.size() && blocked[i].first < end; i++) {
+            end = std::max(end, blocked[i].second);
+        }
+        if (desired > start && desired < end) {
+            return desired - start < end - desired ? start : end;
+        }
+    }
+    return desired;
+}
+
+} // namespace
+
+std::vector<LayoutPos> LayeredLayout(const LayoutGraph &graph) {
+    AINBY_PROFILE_SCOPE("LayeredLayout");
+    u32 nodeCount = graph.nodes.size();
+    std::vector<LayoutPos> positions(nodeCount, LayoutPos { 0, 0 });
+    if (nodeCount == 0) {
+        return positions;
+    }
+
+    std::vector<std::pair<u32, u32>> edges;
+    edges.reserve(graph.edges.size());
+    for (const auto &[from, to] : graph.edges) {
+        if (from != to && from < nodeCount && to < nodeCount) {
+            edges.push_back({ from, to });
+        }
+    }
+    RemoveDuplicateEdges(edges);
+
+    std::vector<u32> parent(nodeCount);
+    std::iota(parent.begin(), parent.end(), 0);
+    for (const auto &[from, to] : edges) {
+        parent[FindComponent(parent, from)] = FindComponent(parent, to);
+    }
+
+    // Components are numbered in the order they are first seen, command roots first.
+    // Within a component, its roots come first, too.
+    std::vector<u32> componentOf(nodeCount, UINT32_MAX);
+    std::vector<std::vector<u32>> components;
+    std::vector<u32> rootCounts;
+    std::vector<u32> componentByRoot(nodeCount, UINT32_MAX);
+    std::vector<bool> isRoot(nodeCount, false);
+    auto addNode = [&](u32 v) {
+        u32 rep = FindComponent(parent, v);
+        if (componentByRoot[rep] == UINT32_MAX) {
+            componentByRoot[rep] = components.size();
+            components.emplace_back();
+            rootCounts.push_back(0);
+        }
+        componentOf[v] = componentByRoot[rep];
+        components[componentOf[v]].push_back(v);
+    };
+    for (u32 root : graph.roots) {
+        if (root < nodeCount && !isRoot[root]) {
+            isRoot[root] = true;
+            addNode(root);
+            rootCounts[componentOf[root]]++;
+        }
+    }
+    for (u32 v = 0; v < nodeCount; v++) {
+        if (!isRoot[v]) {
+            addNode(v);
+        }
+    }
+
+    std::vector<std::vector<std::pair<u32, u32>>> componentEdges(components.size());
+    std::vector<u32> localIdx(nodeCount);
+    for (const std::vector<u32> &component : components) {
+        for (u32 i = 0; i < component.size(); i++) {
+            localIdx[component[i]] = i;
+        }
+    }
+    for (const auto &[from, to] : edges) {
+        componentEdges[componentOf[from]].push_back({ localIdx[from], localIdx[to] });
+    }
+
+    std::vector<std::vector<LayoutPos>> localPositions(components.size());
+    std::vector<LayoutPos> componentSizes(components.size());
+    f32 area = 0;
+    f32 maxWidth = 0;
+    std::vector<LayoutGraph::Node> sizes;
+    for (size_t c = 0; c < components.size(); c++) {
+        sizes.clear();
+        for (u32 v : components[c]) {
+            sizes.push_back(graph.nodes[v]);
+        }
+        ComponentLayout layout(sizes, std::move(componentEdges[c]), rootCounts[c]);
+        componentSizes[c] = layout.Run(localPositions[c]);
+        area += (componentSizes[c].x + COMPONENT_GAP) * (componentSizes[c].y + COMPONENT_GAP);
+        maxWidth = std::max(maxWidth, componentSizes[c].x);
+    }
+
+    // Components are packed into rows of roughly square overall proportions
+    f32 rowWidth = std::max(maxWidth, std::sqrt(area));
+    LayoutPos cursor = { 0, 0 };
+    f32 rowHeight = 0;
+    for (size_t c = 0; c < components.size(); c++) {
+        if (cursor.x > 0 && cursor.x + componentSizes[c].x > rowWidth) {
+            cursor.x = 0;
+            cursor.y += rowHeight + COMPONENT_GAP;
+            rowHeight = 0;
+        }
+        for (u32 i = 0; i < components[c].size(); i++) {
+            positions[components[c][i]] = { cursor.x + localPositions[c][i].x, cursor.y + localPositions[c][i].y };
+        }
+        cursor.x += componentSizes[c].x + COMPONENT_GAP;
+        rowHeight = std::max(rowHeight, componentSizes[c].y);
+    }
+    return positions;
+}
+
+std::vector<LayoutPos> IncrementalLayout(const LayoutGraph &graph, std::vector<LayoutPos> positions, const std::vector<u32> &changedNodes) {
+    AINBY_PROFILE_SCOPE("IncrementalLayout");
+    u32 nodeCount = graph.nodes.size();
+    positions.resize(nodeCount, LayoutPos { 0, 0 });
+
+    std::vector<std::pair<u32, u32>> edges;
+    edges.reserve(graph.edges.size());
+    for (const auto &[from, to] : graph.edges) {
+        if (from != to && from < nodeCount && to < nodeCount) {
+            edges.push_back({ from, to });
+        }
+    }
+    RemoveDuplicateEdges(edges);
+    Adjacency preds, succs;
+    preds.Build(nodeCount, edges, true);
+    succs.Build(nodeCount, edges, false);
+
+    std::vector<bool> placed(nodeCount, true);
+    u32 unplacedCount = 0;
+    for (u32 v : changedNodes) {
+        if (v < nodeCount && placed[v]) {
+            placed[v] = false;
+            unplacedCount++;
+        }
+    }
+    if (unplacedCount == 0) {
+        return positions;
+    }
+
+    // Changed nodes without a path to a fixed node start a new area below everything else
+    LayoutPos newAreaStart = { 0, 0 };
+    bool anyPlaced = false;
+    for (u32 v = 0; v < nodeCount; v++) {
+        if (placed[v]) {
+            newAreaStart.x = anyPlaced ? std::min(newAreaStart.x, positions[v].x) : positions[v].x;
+            newAreaStart.y = std::max(newAreaStart.y, positions[v].y + graph.nodes[v].height + COMPONENT_GAP);
+            anyPlaced = true;
+        }
+    }
+
+    // Nodes are placed outwards from the fixed ones, so every node has at least one
+    // placed neighbour to line up with (except for the first of a new area)
+    std::vector<u32> queue;
+    std::vector<bool> queued(nodeCount, false);
+    auto enqueueNeighbours = [&](u32 v) {
+        for (const Adjacency *adjacency : { &preds, &succs }) {
+            for (u32 n : (*adjacency)[v]) {
+                if (!placed[n] && !queued[n]) {
+                    queued[n] = true;
+                    queue.push_back(n);
+                }
+            }
+        }
+    };
+    for (u32 v : changedNodes) {
+        if (v >= nodeCount || placed[v]) {
+            continue;
+        }
+        for (const Adjacency *adjacency : { &preds, &succs }) {
+            for (u32 n : (*adjacency)[v]) {
+                if (placed[n] && !queued[v]) {
+                    queued[v] = true;
+                    queue.push_back(v);
+                }
+            }
+        }
+    }
+
+    std::vector<std::pair<f32, f32>> blocked;
+    size_t next = 0;
+    u32 nextUnplaced = 0;
+    while (unplacedCount > 0) {
+        if (next == queue.size()) {
+            while (placed[nextUnplaced] || queued[nextUnplaced]) {
+                nextUnplaced++;
+            }
+            queued[nextUnplaced] = true;
+            queue.push_back(nextUnplaced);
+        }
+        u32 v = queue[next++];
+        const LayoutGraph::Node &size = graph.nodes[v];
+
+        // Right of the placed predecessors (or left of the placed successors),
+        // vertically centered on all placed neighbours
+        f32 predRight = -FLT_MAX;
+        f32 succLeft = FLT_MAX;
+        f32 centerSum = 0;
+        u32 neighbourCount = 0;
+        for (u32 n : preds[v]) {
+            if (placed[n]) {
+                predRight = std::max(predRight, positions[n].x + graph.nodes[n].width);
+                centerSum += positions[n].y + graph.nodes[n].height / 2;
+                neighbourCount++;
+            }
+        }
+        for (u32 n : succs[v]) {
+            if (placed[n]) {
+                succLeft = std::min(succLeft, positions[n].x);
+                centerSum += positions[n].y + graph.nodes[n].height / 2;
+                neighbourCount++;
+            }
+        }
+        LayoutPos pos;
+        if (neighbourCount == 0) {
+            pos = newAreaStart;
+        } else {
+            pos.x = predRight != -FLT_MAX ? predRight + LAYER_GAP : succLeft - LAYER_GAP - size.width;
+            pos.y = centerSum / neighbourCount - size.height / 2;
+        }
+
+        // Moved up or down just enough to not overlap any placed node in the same columns
+        blocked.clear();
+        for (u32 n = 0; n < nodeCount; n++) {
+            const LayoutGraph::Node &other = graph.nodes[n];
+            if (placed[n] && positions[n].x < pos.x + size.width + NODE_GAP && positions[n].x + other.width + NODE_GAP > pos.x) {
+                blocked.push_back({ positions[n].y - size.height - NODE_GAP, positions[n].y + other.height + NODE_GAP });
+            }
+        }
+        pos.y = FindFreeTop(blocked, pos.y);
+
+        positions[v] = pos;
+        placed[v] = true;
+        unplacedCount--;
+        if (neighbourCount == 0) {
+            newAreaStart.y = pos.y + size.height + COMPONENT_GAP;
+        }
+        enqueueNeighbours(v);
+    }
+    return positions;
+}
+
+ForceLayout::ForceLayout(LayoutGraph graph, std::vector<LayoutPos> positions, std::vector<bool> pinned)
+    : graph(std::move(graph)), positions(std::move(positions)), pinned(std::move(pinned)) {
+    u32 nodeCount = this->graph.nodes.size();
+    this->positions.resize(nodeCount, LayoutPos { 0, 0 });
+    this->pinned.resize(nodeCount, false);
+
+    std::vector<std::pair<u32, u32>> &edges = this->graph.edges;
+    edges.erase(std::remove_if(edges.begin(), edges.end(), [&](const std::pair<u32, u32> &edge) {
+        return edge.first == edge.second || edge.first >= nodeCount || edge.second >= nodeCount;
+    }), edges.end());
+    RemoveDuplicateEdges(edges);
+
+    f32 sizeSum = 0;
+    for (const LayoutGraph::Node &node : this->graph.nodes) {
+        sizeSum += (node.width + node.height) / 2;
+    }
+    idealDistance = (nodeCount > 0 ? sizeSum / nodeCount : 0) + NODE_GAP;
+    temperature = nodeCount > 0 ? idealDistance * FORCE_START_TEMPERATURE : 0;
+}
+
+void ForceLayout::Pin(u32 node, LayoutPos pos) {
+    positions[node] = pos;
+    pinned[node] = true;
+}
+
+bool ForceLayout::Step() {
+    AINBY_PROFILE_SCOPE("ForceLayout::Step");
+    if (IsConverged()) {
+        return false;
+    }
+
+    u32 nodeCount = graph.nodes.size();
+    centers.resize(nodeCount);
+    LayoutPos centroid = { 0, 0 };
+    for (u32 i = 0; i < nodeCount; i++) {
+        centers[i] = { positions[i].x + graph.nodes[i].width / 2, positions[i].y + graph.nodes[i].height / 2 };
+        centroid.x += centers[i].x / nodeCount;
+        centroid.y += centers[i].y / nodeCount;
+    }
+    BuildQuadtree();
+
+    forces.resize(nodeCount);
+    for (u32 i = 0; i < nodeCount; i++) {
+        forces[i] = pinned[i] ? LayoutPos { 0, 0 } : GetRepulsion(i);
+        forces[i].x -= (centers[i].x - centroid.x) * FORCE_GRAVITY;
+        forces[i].y -= (centers[i].y - centroid.y) * FORCE_GRAVITY;
+    }
+    for (const auto &[from, to] : graph.edges) {
+        f32 dx = centers[to].x - centers[from].x;
+        f32 dy = centers[to].y - centers[from].y;
+        f32 distance = std::max(std::sqrt(dx * dx + dy * dy), 1.0f);
+        f32 attraction = distance / idealDistance;
+        forces[from].x += dx * attraction;
+        forces[from].y += dy * attraction;
+        forces[to].x -= dx * attraction;
+        forces[to].y -= dy * attraction;
+
+        f32 minDx = (graph.nodes[from].width + graph.nodes[to].width) / 2 + LAYER_GAP;
+        if (dx < minDx) {
+            f32 flow = (minDx - dx) * FORCE_FLOW_STRENGTH;
+            forces[from].x -= flow;
+            forces[to].x += flow;
+        }
+    }
+
+    f32 maxMovement = 0;
+    for (u32 i = 0; i < nodeCount; i++) {
+        if (pinned[i]) {
+            continue;
+        }
+        f32 length = std::sqrt(forces[i].x * forces[i].x + forces[i].y * forces[i].y);
+        if (length <= 0) {
+            continue;
+        }
+        f32 movement = std::min(length, temperature);
+        positions[i].x += forces[i].x / length * movement;
+        positions[i].y += forces[i].y / length * movement;
+        maxMovement = std::max(maxMovement, movement);
+    }
+
+    temperature *= FORCE_COOLING;
+    if (maxMovement < FORCE_MIN_MOVEMENT || temperature < FORCE_MIN_MOVEMENT) {
+        temperature = 0;
+    }
+    return !IsConverged();
+}
+
+void ForceLayout::BuildQuadtree() {
+    f32 minX = centers[0].x, minY = centers[0].y, maxX = minX, maxY = minY;
+    for (const LayoutPos &center : centers) {
+        minX = std::min(minX, center.x);
+        minY = std::min(minY, center.y);
+        maxX = std::max(maxX, center.x);
+        maxY = std::max(maxY, center.y);
+    }
+    cells.clear();
+    Cell &root = cells.emplace_back();
+    root.centerX = (minX + maxX) / 2;
+    root.centerY = (minY + maxY) / 2;
+    root.halfSize = std::max(maxX - minX, maxY - minY) / 2 + 1;
+
+    for (u32 i = 0; i < centers.size(); i++) {
+        Insert(i);
+    }
+}
+
+s32 ForceLayout::GetChild(s32 cell, f32 x, f32 y) {
+    int quadrant = (x >= cells[cell].centerX ? 1 : 0) | (y >= cells[cell].centerY ? 2 : 0);
+    if (cells[cell].children[quadrant] == -1) {
+        f32 halfSize = cells[cell].halfSize / 2;
+        Cell child;
+        child.centerX = cells[cell].centerX + (quadrant & 1 ? halfSize : -halfSize);
+        child.centerY = cells[cell].centerY + (quadrant & 2 ? halfSize : -halfSize);
+        child.halfSize = halfSize;
+        cells[cell].children[quadrant] = cells.size();
+        cells.push_back(child);
+    }
+    return cells[cell].children[quadrant];
+}
+
+void ForceLayout::Insert(u32 node) {
+    f32 x = centers[node].x;
+    f32 y = centers[node].y;
+    s32 cell = 0;
+    for (int depth = 0;; depth++) {
+        if (cells[cell].leaf) {
+            if (cells[cell].mass == 0) {
+                cells[cell].node = node;
+            } else if (depth >= FORCE_MAX_DEPTH) {
+                // Nodes at (almost) the same position share a leaf
+                cells[cell].node = -1;
+            } else {
+                // Push the node living here down, then continue like in any other inner cell
+                s32 other = cells[cell].node;
+                cells[cell].leaf = false;
+                cells[cell].node = -1;
+                s32 child = GetChild(cell, centers[other].x, centers[other].y);
+                cells[child].node = other;
+                cells[child].massX = centers[other].x;
+                cells[child].massY = centers[other].y;
+                cells[child].mass = 1;
+            }
+        }
+        cells[cell].massX += x;
+        cells[cell].massY += y;
+        cells[cell].mass += 1;
+        if (cells[cell].leaf) {
+            return;
+        }
+        cell = GetChild(cell, x, y);
+    }
+}
+
+LayoutPos ForceLayout::GetRepulsion(u32 node) {
+    f32 x = centers[node].x;
+    f32 y = centers[node].y;
+    f32 strength = idealDistance * idealDistance;
+    LayoutPos force = { 0, 0 };
+    stack.clear();
+    stack.push_back(0);
+    while (!stack.empty()) {
+        const Cell &cell = cells[stack.back()];
+        stack.pop_back();
+        if (cell.mass == 0 || cell.node == (s32) node) {
+            continue;
+        }
+        f32 dx = x - cell.massX / cell.mass;
+        f32 dy = y - cell.massY / cell.mass;
+        f32 distanceSq = dx * dx + dy * dy;
+        f32 size = cell.halfSize * 2;
+        if (!cell.leaf && size * size >= FORCE_THETA * FORCE_THETA * distanceSq) {
+            for (s32 child : cell.children) {
+                if (child != -1) {
+                    stack.push_back(child);
+                }
+            }
+            continue;
+        }
+        if (distanceSq < 1.0f) {
+            // Nodes on top of each other are pushed apart in a direction that differs per node
+            f32 angle = node * 2.39996f;
+            dx = std::cos(angle);
+            dy = std::sin(angle);
+            distanceSq = 1.0f;
+        }
+        // strength * mass / distance, in the direction away from the cell
+        f32 magnitude = strength * cell.mass / distanceSq;
+        force.x += dx * magnitude;
+        force.y += dy * magnitude;
+    }
+    return force;
+}
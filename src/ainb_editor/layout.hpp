@@ -0,0 +1,83 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include "types.h"
+
+// Graph to be laid out. It does not reference the AINB or any ImGui state, so
+// that layouts can be computed on a snapshot away from the UI thread.
+struct LayoutGraph {
+    struct Node {
+        f32 width;
+        f32 height;
+    };
+    std::vector<Node> nodes;
+    // Directed edges (from, to) between node indices, flowing left to right.
+    // Duplicates and self loops are allowed and ignored.
+    std::vector<std::pair<u32, u32>> edges;
+    // Nodes that should start a layer (command roots). Their components are placed first.
+    std::vector<u32> roots;
+};
+
+struct LayoutPos {
+    f32 x;
+    f32 y;
+};
+
+// Layered (Sugiyama style) layout: breaks cycles, assigns layers by longest path,
+// orders every layer by barycenters to reduce crossings and places nodes as close
+// to their neighbours as the node sizes allow. Every weakly connected component
+// is laid out on its own and the results are packed into rows.
+// Returns the top left corner of every node.
+std::vector<LayoutPos> LayeredLayout(const LayoutGraph &graph);
+
+// Places the changed nodes (added ones, or ones whose links or size changed) next to
+// their neighbours while every other node keeps its position. The positions of the
+// changed nodes are ignored; removed nodes are expected to be gone from the graph.
+// Costs about one pass over the graph per changed node, so local edits are cheap.
+std::vector<LayoutPos> IncrementalLayout(const LayoutGraph &graph, std::vector<LayoutPos> positions, const std::vector<u32> &changedNodes);
+
+// Force directed layout (Fruchterman-Reingold, with a Barnes-Hut quadtree for the
+// repulsion between all nodes). It is run a step at a time, so that callers can
+// spread it over several frames and show it converging.
+class ForceLayout {
+public:
+    // positions are the top left corners to start from, pinned nodes are never moved
+    ForceLayout(LayoutGraph graph, std::vector<LayoutPos> positions, std::vector<bool> pinned);
+
+    // Runs one iteration. Returns false once the layout has converged.
+    bool Step();
+    // Fixes a node at the given position, e.g. because the user moved it
+    void Pin(u32 node, LayoutPos pos);
+
+    bool IsConverged() const { return temperature <= 0; }
+    const std::vector<LayoutPos> &GetPositions() const { return positions; }
+
+private:
+    // Quadtree cell; leaves hold one node, except at the maximum depth
+    struct Cell {
+        f32 centerX, centerY, halfSize;
+        f32 massX = 0, massY = 0, mass = 0;
+        s32 children[4] = { -1, -1, -1, -1 };
+        s32 node = -1;
+        bool leaf = true;
+    };
+
+    void BuildQuadtree();
+    void Insert(u32 node);
+    s32 GetChild(s32 cell, f32 x, f32 y);
+    LayoutPos GetRepulsion(u32 node);
+
+    LayoutGraph graph;
+    std::vector<LayoutPos> positions;
+    std::vector<bool> pinned;
+
+    f32 idealDistance;
+    f32 temperature;
+
+    std::vector<LayoutPos> centers;
+    std::vector<LayoutPos> forces;
+    std::vector<Cell> cells;
+    std::vector<s32> stack;
+};
@@ -0,0 +1,72 @@
+#include "layout_cache.hpp"
+
+#include <cstring>
+#include <fstream>
+
+#include "util/archive_cache.hpp"
+#include "util/hash.hpp"
+#include "util/mapped_file.hpp"
+
+namespace fs = std::filesystem;
+
+#define LAYOUT_CACHE_VERSION 1
+
+LayoutCache::LayoutCache(const fs::path &directory) : directory(directory) {
+    fs::create_directories(directory);
+}
+
+bool LayoutCache::Load(u64 key, std::vector<LayoutPos> &positions) const {
+    fs::path entryPath = GetEntryPath(key);
+    std::error_code ec;
+    if (!fs::exists(entryPath, ec)) {
+        return false;
+    }
+
+    MappedFile file(entryPath);
+    size_t size;
+    const u8 *data = file.GetData(size);
+    if (size < sizeof(Header)) {
+        return false;
+    }
+    Header header;
+    memcpy(&header, data, sizeof(Header));
+    if (memcmp(header.magic, "ALYT", 4) != 0 || header.version != LAYOUT_CACHE_VERSION || header.key != key) {
+        return false;
+    }
+    if (size != sizeof(Header) + (size_t) header.positionCount * sizeof(LayoutPos)) {
+        return false;
+    }
+    positions.resize(header.positionCount);
+    memcpy(positions.data(), data + sizeof(Header), header.positionCount * sizeof(LayoutPos));
+    return true;
+}
+
+void LayoutCache::Store(u64 key, const std::vector<LayoutPos> &positions) const {
+    Header header = {};
+    memcpy(header.magic, "ALYT", 4);
+    header.version = LAYOUT_CACHE_VERSION;
+    header.key = key;
+    header.positionCount = positions.size();
+
+    // Written to a temporary file first, so that a crash never leaves a broken entry behind
+    fs::path entryPath = GetEntryPath(key);
+    fs::path tempPath = entryPath;
+    tempPath += ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary);
+        file.write((const char *) &header, sizeof(Header));
+        file.write((const char *) positions.data(), positions.size() * sizeof(LayoutPos));
+        if (!file) {
+            throw std::runtime_error("Could not write layout cache entry " + tempPath.string());
+        }
+    }
+    fs::rename(tempPath, entryPath);
+}
+
+fs::path LayoutCache::DefaultDirectory() {
+    return ArchiveCache::DefaultDirectory() / "layouts";
+}
+
+fs::path LayoutCache::GetEntryPath(u64 key) const {
+    return directory / (HashToString(key) + ".layout");
+}
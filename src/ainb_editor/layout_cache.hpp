@@ -0,0 +1,34 @@
+#pragma once
+
+#include <filesystem>
+#include <vector>
+
+#include "layout.hpp"
+#include "types.h"
+
+// On-disk cache of node positions, one small binary file per AINB. Entries are
+// keyed by a hash of the AINB data and the path it was opened from, so a layout
+// is only ever restored for exactly the same file.
+class LayoutCache {
+public:
+    LayoutCache(const std::filesystem::path &directory);
+
+    // Returns false if there is no usable entry for the key
+    bool Load(u64 key, std::vector<LayoutPos> &positions) const;
+    void Store(u64 key, const std::vector<LayoutPos> &positions) const;
+
+    static std::filesystem::path DefaultDirectory();
+
+private:
+    struct Header {
+        char magic[4];
+        u32 version;
+        u64 key;
+        u32 positionCount;
+        u32 reserved;
+    };
+
+    std::filesystem::path GetEntryPath(u64 key) const;
+
+    std::filesystem::path directory;
+};
@@ -8,9 +8,16 @@
 #include <imgui_internal.h> // Internal header needed for DockSpaceXXX functions
 #include <tinyfiledialogs.h>
 
+#include "file_formats/format.hpp"
 #include "file_formats/zstd.hpp"
+#include "util/hash.hpp"
+#include "util/profiler.hpp"
+
+// Maximum size of the decompressed archive cache on disk
+#define ARCHIVE_CACHE_SIZE ((size_t) 2 << 30)
 
 void AINBY::Draw() {
+    AINBY_PROFILE_SCOPE("AINBY::Draw");
     // Main Window -- Menu bar + Error popup
     ImGuiViewport* viewport = ImGui::GetMainViewport();
     ImGui::SetNextWindowPos(viewport->Pos);
@@ -50,23 +57,100 @@ void AINBY::Draw() {
             editor.DrawNodeEditor();
         }
     ImGui::End();
+
+#ifdef AINBY_PROFILER
+    if (showProfiler) {
+        profilerWindow.Draw(&showProfiler);
+    }
+#endif
+}
+
+bool AINBY::IsBusy() const {
+    return firstFrame || shouldOpenErrorPopup || (ainbLoaded && editor.IsBusy());
+}
+
+ArchiveCache *AINBY::GetArchiveCache() {
+    if (!useArchiveCache) {
+        return nullptr;
+    }
+    if (archiveCache == nullptr) {
+        archiveCache = std::make_unique<ArchiveCache>(ArchiveCache::DefaultDirectory(), ARCHIVE_CACHE_SIZE);
+    }
+    return archiveCache.get();
+}
+
+LayoutCache *AINBY::GetLayoutCache() {
+    if (!useLayoutCache) {
+        return nullptr;
+    }
+    if (layoutCache == nullptr) {
+        layoutCache = std::make_unique<LayoutCache>(LayoutCache::DefaultDirectory());
+    }
+    return layoutCache.get();
+}
+
+void AINBY::OpenFile(const char *path) {
+    AINBY_PROFILE_SCOPE("AINBY::OpenFile");
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>(path);
+
+    size_t size;
+    const u8 *data = file->GetData(size);
+    OpenData(data, size, file, path);
+}
+
+void AINBY::OpenData(const u8 *data, size_t size, std::shared_ptr<const void> backing, const std::string &path) {
+    // Unwrap the compression first, every stage after this only passes views around
+    backing = UnwrapZSTD(data, size, backing, GetArchiveCache());
+
+    switch (DetectFormat(data, size)) {
+        case FileFormat::SARC: {
+            SARC sarc;
+            sarc.Read(data, size);
+            currentSarc = std::move(sarc);
+            currentSarcPath = path;
+            sarcFileList = currentSarc.GetFileList();
+            std::sort(sarcFileList.begin(), sarcFileList.end());
+            openedData = std::move(backing);
+            sarcLoaded = true;
+            break;
+        }
+        case FileFormat::AINB:
+            LoadAINB(data, size, path);
+            break;
+        default:
+            throw std::runtime_error("Unknown file format");
+    }
+}
+
+void AINBY::LoadAINB(const u8 *data, size_t size, const std::string &path) {
+    AINBY_PROFILE_SCOPE("AINBY::LoadAINB");
+    if (DetectFormat(data, size) != FileFormat::AINB) {
+        throw std::runtime_error("Not an AINB file");
+    }
+    std::istrstream stream((const char *) data, size);
+    currentAinb.Read(stream);
+    editor.SetLayoutCache(GetLayoutCache());
+    u64 layoutKey = HashData(data, size, HashData((const u8 *) path.data(), path.size()));
+    editor.RegisterAINB(currentAinb, layoutKey);
+    ainbLoaded = true;
 }
 
 void AINBY::DrawMainWindow() {
-    // TODO: Make this a simple "Open" item instead and detect the file type automatically
-    int openFileType = -1;
+    bool openFile = false;
+    bool openRomfs = false;
     bool savePack = false;
     bool saveSZ = false;
+    bool saveSeekableSZ = false;
+#ifdef AINBY_PROFILER
+    bool startTrace = false;
+#endif
     if (ImGui::BeginMenuBar()) {
         if (ImGui::BeginMenu("File")) {
-            if (ImGui::MenuItem("Open .zs")) {
-                openFileType = 2;
+            if (ImGui::MenuItem("Open")) {
+                openFile = true;
             }
-            if (ImGui::MenuItem("Open .pack")) {
-                openFileType = 0;
-            }
-            if (ImGui::MenuItem("Open .ainb")) {
-                openFileType = 1;
+            if (ImGui::MenuItem("Open romfs folder")) {
+                openRomfs = true;
             }
             if (ImGui::MenuItem("Save .pack")) {
                 savePack = true;
@@ -74,37 +158,72 @@ void AINBY::DrawMainWindow() {
             if (ImGui::MenuItem("Save .zs")) {
                 saveSZ = true;
             }
+            if (ImGui::MenuItem("Save .zs (seekable)")) {
+                saveSeekableSZ = true;
+            }
+            if (ImGui::MenuItem("Cache decompressed .zs files", nullptr, &useArchiveCache)) {
+                // The mounted romfs would otherwise keep the setting it was mounted with
+                vfs.SetArchiveCache(GetArchiveCache());
+            }
+            if (ImGui::MenuItem("Remember node layouts", nullptr, &useLayoutCache)) {
+                // Also applies to the open file, which would otherwise still be stored when it is closed
+                editor.SetLayoutCache(GetLayoutCache());
+            }
             if (ImGui::MenuItem("Exit")) {
                 shouldClose = true;
             }
             ImGui::EndMenu();
         }
+#ifdef AINBY_PROFILER
+        if (ImGui::BeginMenu("View")) {
+            ImGui::MenuItem("Profiler", nullptr, &showProfiler);
+            bool tracing = Profiler::IsTracing();
+            if (ImGui::MenuItem("Record trace", nullptr, tracing)) {
+                if (tracing) {
+                    Profiler::StopTrace();
+                } else {
+                    startTrace = true;
+                }
+            }
+            ImGui::EndMenu();
+        }
+#endif
         ImGui::EndMenuBar();
     }
 
-    if (openFileType != -1) {
-        const char *path = tinyfd_openFileDialog("Open file", "", 0, nullptr, nullptr, 0);
+#ifdef AINBY_PROFILER
+    if (startTrace) {
+        const char *filters[] = { "*.json" };
+        const char *path = tinyfd_saveFileDialog("Save trace", "ainby_trace.json", 1, filters, "Chrome trace");
         if (path != nullptr) {
             try {
-                std::ifstream file(path, std::ios::binary);
-                if (openFileType == 0) {
-                    currentSarc.Read(file);
-                    sarcLoaded = true;
-                } else if (openFileType == 1) {
-                    currentAinb.Read(file);
-                    editor.RegisterAINB(currentAinb);
-                    ainbLoaded = true;
-                } else {
-                    ZSTD zstdFile;
-                    zstdFile.Read(file);
+                Profiler::StartTrace(path);
+            } catch (std::exception &e) {
+                fileOpenErrorMessage = e.what();
+                shouldOpenErrorPopup = true;
+            }
+        }
+    }
+#endif
 
-                    size_t decompressedSize;
-                    const u8 *decompressed = zstdFile.GetData(decompressedSize);
+    if (openFile) {
+        const char *path = tinyfd_openFileDialog("Open file", "", 0, nullptr, nullptr, 0);
+        if (path != nullptr) {
+            try {
+                OpenFile(path);
+            } catch (std::exception &e) {
+                fileOpenErrorMessage = e.what();
+                shouldOpenErrorPopup = true;
+            }
+        }
+    }
 
-                    std::istrstream stream((const char *) decompressed, decompressedSize);
-                    currentSarc.Read(stream);
-                    sarcLoaded = true;
-                }
+    if (openRomfs) {
+        const char *path = tinyfd_selectFolderDialog("Open romfs folder", "");
+        if (path != nullptr) {
+            try {
+                vfs.Mount(path);
+                vfs.SetArchiveCache(GetArchiveCache());
             } catch (std::exception &e) {
                 fileOpenErrorMessage = e.what();
                 shouldOpenErrorPopup = true;
@@ -125,7 +244,7 @@ void AINBY::DrawMainWindow() {
         }
     }
 
-    if (saveSZ) {
+    if (saveSZ || saveSeekableSZ) {
         const char *path = tinyfd_saveFileDialog("Save file", "", 0, nullptr, nullptr);
         if (path != nullptr) {
             try {
@@ -133,7 +252,11 @@ void AINBY::DrawMainWindow() {
                 currentSarc.Write(stream);
 
                 std::ofstream file(path, std::ios::binary);
-                ZSTD::Write(file, (const u8 *) stream.str(), stream.pcount());
+                if (saveSeekableSZ) {
+                    ZSTD::WriteSeekable(file, (const u8 *) stream.str(), stream.pcount());
+                } else {
+                    ZSTD::Write(file, (const u8 *) stream.str(), stream.pcount());
+                }
 
                 stream.freeze(false);
             } catch (std::exception &e) {
@@ -176,22 +299,35 @@ void AINBY::DrawMainWindow() {
 }
 
 void AINBY::DrawFileBrowser() {
-    if (!sarcLoaded) {
+    if (!sarcLoaded && !vfs.IsMounted()) {
         ImGui::Text("No file loaded");
         return;
     }
-    if (ImGui::TreeNodeEx("Files", ImGuiTreeNodeFlags_DefaultOpen)) {
-        std::string selectedFile = DrawFileTree(currentSarc.GetFileList());
+    if (vfs.IsMounted() && ImGui::TreeNodeEx("romfs")) {
+        std::shared_ptr<const std::vector<std::string>> hostFiles = vfs.GetHostFiles();
+        std::string selectedFile = DrawFileTree(*hostFiles);
+
+        if (selectedFile != "") {
+            try {
+                VFS::File file = vfs.Open(selectedFile);
+                OpenData(file.data, file.size, file.backing, selectedFile);
+            } catch (std::exception &e) {
+                fileOpenErrorMessage = e.what();
+                shouldOpenErrorPopup = true;
+            }
+        }
+
+        ImGui::TreePop();
+    }
+    if (sarcLoaded && ImGui::TreeNodeEx("Files", ImGuiTreeNodeFlags_DefaultOpen)) {
+        std::string selectedFile = DrawFileTree(sarcFileList);
 
         if (selectedFile != "") {
             u32 fileSize;
             const u8 *buffer = currentSarc.GetFileByPath(selectedFile, fileSize);
 
-            std::istrstream stream((const char *) buffer, fileSize);
             try {
-                currentAinb.Read(stream);
-                editor.RegisterAINB(currentAinb);
-                ainbLoaded = true;
+                LoadAINB(buffer, fileSize, currentSarcPath + "/" + selectedFile);
             } catch (std::exception &e) {
                 fileOpenErrorMessage = e.what();
                 shouldOpenErrorPopup = true;
@@ -204,12 +340,7 @@ void AINBY::DrawFileBrowser() {
     }
 }
 
-std::string AINBY::DrawFileTree(const std::vector<std::string> &fileList) {
-    // Sort file list so that the drawing algorithm works correctly
-    // (and also so that the files are in alphabetical order lol)
-    std::vector<std::string> sortedFileList = fileList;
-    std::sort(sortedFileList.begin(), sortedFileList.end());
-
+std::string AINBY::DrawFileTree(const std::vector<std::string> &sortedFileList) {
     // Keep track of opened folders
     std::vector<std::string> currPath;
     std::vector<bool> isOpened;
@@ -1,30 +1,63 @@
 #pragma once
 
 #include "ainb_editor/ainb_editor.hpp"
+#include "ainb_editor/layout_cache.hpp"
 #include "file_formats/ainb.hpp"
 #include "file_formats/sarc.hpp"
+#include "profiler_window.hpp"
+#include "util/archive_cache.hpp"
+#include "vfs/vfs.hpp"
 
 // Main editor class
 class AINBY {
 private:
+    // Declared before the editor, which stores its layout into it when destroyed
+    std::unique_ptr<LayoutCache> layoutCache;
+    bool useLayoutCache = true;
+
     AINBEditor editor;
 
     SARC currentSarc;
+    std::string currentSarcPath;
     bool sarcLoaded = false;
+    std::vector<std::string> sarcFileList;
+    // Backing storage of the opened archive, currentSarc only holds views into it
+    std::shared_ptr<const void> openedData;
+
+    VFS vfs;
     AINB currentAinb;
     bool ainbLoaded = false;
 
+    std::unique_ptr<ArchiveCache> archiveCache;
+    bool useArchiveCache = true;
+
     bool shouldOpenErrorPopup = false;
     std::string fileOpenErrorMessage = "";
 
     bool firstFrame = true;
 
+#ifdef AINBY_PROFILER
+    ProfilerWindow profilerWindow;
+    bool showProfiler = false;
+#endif
+
+    ArchiveCache *GetArchiveCache();
+    LayoutCache *GetLayoutCache();
+    void OpenFile(const char *path);
+    // path is only used to tell apart identical files in different places
+    void OpenData(const u8 *data, size_t size, std::shared_ptr<const void> backing, const std::string &path);
+    void LoadAINB(const u8 *data, size_t size, const std::string &path);
+
     void DrawMainWindow();
     void DrawFileBrowser();
-    std::string DrawFileTree(const std::vector<std::string> &fileList);
+    // The file list has to be sorted so that the drawing algorithm works correctly
+    // (and also so that the files are in alphabetical order lol)
+    std::string DrawFileTree(const std::vector<std::string> &sortedFileList);
 
 public:
     void Draw();
+    // Whether the next frame would look different even without any input
+    bool IsBusy() const;
 
     bool shouldClose = false;
 };
@@ -1,11 +1,13 @@
 #include "ainb.hpp"
 
 #include <cassert>
+#include <cstdio>
 #include <cstring>
 #include <iostream>
-#include <sstream>
 #include <unordered_map>
 
+#include "util/profiler.hpp"
+
 void AINB::Clear() {
     ainbFile = nullptr;
     ainbHeader = {};
@@ -25,6 +27,7 @@ void AINB::Clear() {
 }
 
 void AINB::Read(std::istream &stream) {
+    AINBY_PROFILE_SCOPE("AINB::Read");
     Clear();
     ainbFile = &stream;
 
@@ -351,7 +354,7 @@ void AINB::Node::ReadBody(AINB &ainb) {
 
 // TODO: find a better way to do this
 
-std::vector<std::reference_wrapper<AINB::Param>> AINB::Node::GetParams() {
+const std::vector<std::reference_wrapper<AINB::Param>> &AINB::Node::GetParams() {
     if (!isMutableParamsDirty) {
         return mutableParams;
     }
@@ -371,7 +374,7 @@ std::vector<std::reference_wrapper<AINB::Param>> AINB::Node::GetParams() {
     return mutableParams;
 }
 
-std::vector<std::reference_wrapper<const AINB::Param>> AINB::Node::GetParams() const {
+const std::vector<std::reference_wrapper<const AINB::Param>> &AINB::Node::GetParams() const {
     if (!isConstParamsDirty) {
         return constParams;
     }
@@ -420,11 +423,17 @@ std::unordered_map<AINB::NodeType, std::string> nodeTypeNames = {
     {AINB::Element_SplitTiming, "SplitTiming" }
 };
 
-std::string AINB::Node::TypeName() const {
+const std::string &AINB::Node::TypeName() const {
+    static const std::string unknownName = "Unknown";
     if (data.type == UserDefined) {
         return name;
     }
-    return nodeTypeNames[data.type];
+    // Not operator[], so that this doesn't modify the map (nodes are read from multiple threads by the indexer)
+    auto it = nodeTypeNames.find(data.type);
+    if (it == nodeTypeNames.end()) {
+        return unknownName;
+    }
+    return it->second;
 }
 
 void AINB::NodeLink::Read(AINB &ainb, NodeType parentNodeType) {
@@ -544,8 +553,28 @@ std::ostream &operator<<(std::ostream &os, const vec3f &vec) {
     return os;
 }
 
-std::string AINB::AINBValueToString(ainbValue v) {
-    std::stringstream ss;
-    std::visit([&](const auto &elem) { ss << elem; }, v);
-    return ss.str();
+// Same output as streaming the value, without setting up a stream for every call
+std::string AINB::AINBValueToString(const ainbValue &v) {
+    char buf[64];
+    switch (v.index()) {
+        case 0:
+            snprintf(buf, sizeof(buf), "%u", std::get<u32>(v));
+            break;
+        case 1:
+            snprintf(buf, sizeof(buf), "%d", std::get<bool>(v) ? 1 : 0);
+            break;
+        case 2:
+            snprintf(buf, sizeof(buf), "%g", std::get<f32>(v));
+            break;
+        case 3:
+            return std::get<std::string>(v);
+        case 4: {
+            const vec3f &vec = std::get<vec3f>(v);
+            snprintf(buf, sizeof(buf), "%g, %g, %g", vec.x, vec.y, vec.z);
+            break;
+        }
+        default:
+            return "";
+    }
+    return buf;
 }
@@ -16,7 +16,7 @@ std::ostream &operator<<(std::ostream &os, const vec3f &vec);
 class AINB {
 public:
     using ainbValue = std::variant<u32, bool, f32, std::string, vec3f>; // Same order as ValueType enum
-    static std::string AINBValueToString(ainbValue v);
+    static std::string AINBValueToString(const ainbValue &v);
 
     struct GUID {
         u32 d1;
@@ -225,7 +225,7 @@ public:
         mutable std::vector<std::reference_wrapper<AINB::Param>> mutableParams;
 
     public:
-        std::string TypeName() const;
+        const std::string &TypeName() const;
 
         u16 Idx() const { return data.idx; }
         const std::vector<const Node *> &GetInNodes() const { return inNodes; }
@@ -234,8 +234,8 @@ public:
         std::vector<ImmediateParam> immParams[ValueTypeCount];
         std::vector<InputParam> inputParams[ValueTypeCount];
         std::vector<OutputParam> outputParams[ValueTypeCount];
-        std::vector<std::reference_wrapper<Param>> GetParams();
-        std::vector<std::reference_wrapper<const Param>> GetParams() const;
+        const std::vector<std::reference_wrapper<Param>> &GetParams();
+        const std::vector<std::reference_wrapper<const Param>> &GetParams() const;
 
         std::string name; // Empty string if type != UserDefined
         NodeType type;
@@ -0,0 +1,29 @@
+#include "format.hpp"
+
+#include <cstring>
+
+FileFormat DetectFormat(const u8 *data, size_t size) {
+    if (size < 4) {
+        return FileFormat::Unknown;
+    }
+    // zstd frame magic 0xFD2FB528 (little endian)
+    if (data[0] == 0x28 && data[1] == 0xB5 && data[2] == 0x2F && data[3] == 0xFD) {
+        return FileFormat::ZSTD;
+    }
+    if (memcmp(data, "SARC", 4) == 0) {
+        return FileFormat::SARC;
+    }
+    if (memcmp(data, "AIB ", 4) == 0) {
+        return FileFormat::AINB;
+    }
+    return FileFormat::Unknown;
+}
+
+const char *FileFormatName(FileFormat format) {
+    switch (format) {
+        case FileFormat::ZSTD: return "zstd";
+        case FileFormat::SARC: return "SARC";
+        case FileFormat::AINB: return "AINB";
+        default: return "unknown";
+    }
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+
+#include "types.h"
+
+enum class FileFormat {
+    Unknown,
+    ZSTD,
+    SARC,
+    AINB
+};
+
+// Guesses the format of a file from its magic bytes
+FileFormat DetectFormat(const u8 *data, size_t size);
+const char *FileFormatName(FileFormat format);
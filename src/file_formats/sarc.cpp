@@ -1,9 +1,12 @@
 #include "sarc.hpp"
 
 #include <cassert>
+#include <cstdint>
 #include <cstring>
 #include <sstream>
 
+#include "util/profiler.hpp"
+
 #define ALIGN4(x) (((x) + 3) & ~3)
 #define ALIGN8(x) (((x) + 7) & ~7)
 
@@ -12,6 +15,7 @@ void SARC::Clear() {
 }
 
 void SARC::Read(std::istream &sarcFile) {
+    AINBY_PROFILE_SCOPE("SARC::Read");
     Clear();
     SARCHeader sarcHeader;
     sarcFile.read((char *) &sarcHeader, sizeof(SARCHeader));
@@ -61,16 +65,110 @@ void SARC::Read(std::istream &sarcFile) {
             std::getline(sarcFile, filePath, '\0');
         }
 
+        if (node.nodeFileDataEnd < node.nodeFileDataBegin || node.nodeFileDataEnd > UINT32_MAX - dataBegin) {
+            throw std::runtime_error("Invalid SFAT file range");
+        }
         u32 size = node.nodeFileDataEnd - node.nodeFileDataBegin;
 
+        std::unique_ptr<u8[]> data = std::make_unique<u8[]>(size);
+        sarcFile.seekg(node.nodeFileDataBegin + dataBegin);
+        sarcFile.read((char *) data.get(), size);
+
         files[filePath] = SFATFile {
             size,
-            std::make_unique<u8[]>(size)
+            data.get(),
+            std::move(data)
         };
+    }
+}
 
-        sarcFile.seekg(node.nodeFileDataBegin + dataBegin);
-        sarcFile.read((char *) files[filePath].data.get(), size);
+void SARC::Read(const u8 *sarcData, size_t sarcSize) {
+    AINBY_PROFILE_SCOPE("SARC::Read");
+    Clear();
+    auto readAt = [&](u8 *dest, size_t offset, size_t size) {
+        if (offset + size > sarcSize) {
+            throw std::runtime_error("Unexpected end of SARC file");
+        }
+        memcpy(dest, sarcData + offset, size);
+    };
+
+    for (const auto &[path, entry] : ReadIndex(readAt)) {
+        if ((size_t) entry.offset + entry.size > sarcSize) {
+            throw std::runtime_error("Unexpected end of SARC file");
+        }
+        files[path] = SFATFile {
+            entry.size,
+            sarcData + entry.offset,
+            nullptr
+        };
+    }
+}
+
+std::unordered_map<std::string, SARC::FileEntry> SARC::ReadIndex(const ReadAtFunc &readAt) {
+    SARCHeader sarcHeader;
+    readAt((u8 *) &sarcHeader, 0, sizeof(SARCHeader));
+
+    if (strncmp(sarcHeader.magic, "SARC", 4) != 0) {
+        throw std::runtime_error("Invalid SARC magic");
+    }
+    assert(sarcHeader.headerLen == 0x14);
+    assert(sarcHeader.bom == 0xFEFF);
+    assert(sarcHeader.versionNum == 0x0100);
+
+    u32 dataBegin = sarcHeader.dataBegin;
+
+    SFATHeader sfatHeader;
+    readAt((u8 *) &sfatHeader, sizeof(SARCHeader), sizeof(SFATHeader));
+
+    if (strncmp(sfatHeader.magic, "SFAT", 4) != 0) {
+        throw std::runtime_error("Invalid SFAT magic");
+    }
+    assert(sfatHeader.headerLen == 0xC);
+    assert(sfatHeader.hashKey == 0x65);
+
+    // Everything up to the file data (node table and name table) is read in one go
+    size_t tablesStart = sizeof(SARCHeader) + sizeof(SFATHeader);
+    size_t stringStart = tablesStart + sfatHeader.nodeCount * sizeof(SFATNode) + sizeof(SFNTHeader);
+    if (dataBegin < stringStart) {
+        throw std::runtime_error("Invalid SARC data offset");
+    }
+    std::vector<u8> tables(dataBegin - tablesStart);
+    readAt(tables.data(), tablesStart, tables.size());
+
+    const SFATNode *sfatNodes = (const SFATNode *) tables.data();
+    const SFNTHeader *sfntHeader = (const SFNTHeader *) (sfatNodes + sfatHeader.nodeCount);
+
+    if (strncmp(sfntHeader->magic, "SFNT", 4) != 0) {
+        throw std::runtime_error("Invalid SFNT magic");
+    }
+    assert(sfntHeader->headerLen == 0x8);
+
+    const char *strings = (const char *) (sfntHeader + 1);
+    size_t stringsSize = dataBegin - stringStart;
+
+    std::unordered_map<std::string, FileEntry> index;
+    index.reserve(sfatHeader.nodeCount);
+    for (int i = 0; i < sfatHeader.nodeCount; i++) {
+        const SFATNode &node = sfatNodes[i];
+        if ((node.fileAttributes >> 24) == 0) {
+            throw std::runtime_error("File name by hash not supported");
+        }
+        u32 offset = (node.fileAttributes & 0xFFFFFF) * 4;
+        if (offset >= stringsSize) {
+            throw std::runtime_error("Invalid SFNT name offset");
+        }
+        std::string filePath(strings + offset, strnlen(strings + offset, stringsSize - offset));
+
+        // Offsets are relative to dataBegin, the absolute ones have to fit into a u32 as well
+        if (node.nodeFileDataEnd < node.nodeFileDataBegin || node.nodeFileDataEnd > UINT32_MAX - dataBegin) {
+            throw std::runtime_error("Invalid SFAT file range");
+        }
+        index[filePath] = FileEntry {
+            dataBegin + node.nodeFileDataBegin,
+            node.nodeFileDataEnd - node.nodeFileDataBegin
+        };
     }
+    return index;
 }
 
 void SARC::Write(std::ostream &sarcFile) const {
@@ -132,7 +230,7 @@ void SARC::Write(std::ostream &sarcFile) const {
     for (const auto &[path, _] : files) {
         const SFATFile &file = files.at(path);
         WriteAlign(sarcFile, 8);
-        sarcFile.write((const char *) file.data.get(), file.size);
+        sarcFile.write((const char *) file.data, file.size);
     }
     WriteAlign(sarcFile, 4);
 
@@ -154,7 +252,7 @@ const u8 *SARC::GetFileByPath(const std::string &path, u32 &size) const {
     }
     const SFATFile &file = files.at(path);
     size = file.size;
-    return file.data.get();
+    return file.data;
 }
 
 const std::vector<std::string> SARC::GetFileList() const {
@@ -166,11 +264,13 @@ const std::vector<std::string> SARC::GetFileList() const {
 }
 
 void SARC::SetFile(const std::string &path, const u8 *data, u32 size) {
+    std::unique_ptr<u8[]> ownedData = std::make_unique<u8[]>(size);
+    memcpy(ownedData.get(), data, size);
     files[path] = SFATFile {
         size,
-        std::make_unique<u8[]>(size)
+        ownedData.get(),
+        std::move(ownedData)
     };
-    memcpy(files[path].data.get(), data, size);
 }
 
 void SARC::RemoveFile(const std::string &path) {
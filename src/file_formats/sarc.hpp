@@ -2,16 +2,32 @@
 
 #include <istream>
 #include <fstream>
+#include <functional>
 #include <memory>
 #include <string>
 #include <map>
+#include <unordered_map>
 #include <vector>
 
 #include "types.h"
 
 class SARC {
 public:
+    // Location of a file's data inside the archive
+    struct FileEntry {
+        u32 offset;
+        u32 size;
+    };
+    // Reads size bytes starting at offset of the (decompressed) archive into dest
+    using ReadAtFunc = std::function<void(u8 *dest, size_t offset, size_t size)>;
+
     void Read(std::istream &sarcFile);
+    // Reads the archive without copying the file data; the buffer has to stay
+    // alive (and unchanged) for as long as this SARC or its files are used
+    void Read(const u8 *sarcData, size_t sarcSize);
+    // Only reads the header and file tables, without touching any file data.
+    // Together with ZSTDSeekable this avoids decompressing the whole archive.
+    static std::unordered_map<std::string, FileEntry> ReadIndex(const ReadAtFunc &readAt);
     void Write(std::ostream &sarcFile) const;
     void Clear();
 
@@ -55,7 +71,9 @@ private:
 
     struct SFATFile {
         u32 size;
-        std::unique_ptr<u8[]> data;
+        // Points either into ownedData or into the buffer the archive was read from
+        const u8 *data;
+        std::unique_ptr<u8[]> ownedData;
     };
     struct cmpByHash {
         bool operator()(const std::string &a, const std::string &b) const {
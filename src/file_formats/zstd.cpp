@@ -1,26 +1,73 @@
 #include "zstd.hpp"
 
+#include <algorithm>
+#include <cstdio>
+
+#define ZSTD_STATIC_LINKING_ONLY
 #include <zstd.h>
+#include <zstd_seekable.h>
+
+#include "util/profiler.hpp"
 
 void ZSTD::Read(std::istream &szFile) {
-    // This could maybe use streaming decompression in the future...
-    // probably not worth it though, the SZ files are small enough
     szFile.seekg(0, std::ios::end);
     size_t szCompressedSize = szFile.tellg();
     szFile.seekg(0, std::ios::beg);
     std::vector<u8> buffer(szCompressedSize);
     szFile.read((char *) buffer.data(), szCompressedSize);
 
-    size = ZSTD_getFrameContentSize(buffer.data(), szCompressedSize);
-    if (size == ZSTD_CONTENTSIZE_ERROR || size == ZSTD_CONTENTSIZE_UNKNOWN) {
+    Read(buffer.data(), szCompressedSize);
+}
+
+void ZSTD::Read(const u8 *szData, size_t szSize) {
+    AINBY_PROFILE_SCOPE("ZSTD::Read");
+    // Sums up the sizes of all frames, so files written in multiple frames work too
+    size = ZSTD_findDecompressedSize(szData, szSize);
+    if (size == ZSTD_CONTENTSIZE_ERROR) {
         throw std::runtime_error("Could not get decompressed size of SZ file");
     }
-    data.resize(size);
 
-    size_t res = ZSTD_decompress(data.data(), size, buffer.data(), szCompressedSize);
-    if (ZSTD_isError(res)) {
-        throw std::runtime_error("Could not decompress SZ file: " + std::string(ZSTD_getErrorName(res)));
+    if (size != ZSTD_CONTENTSIZE_UNKNOWN) {
+        data.resize(size);
+        size_t res = ZSTD_decompress(data.data(), size, szData, szSize);
+        if (ZSTD_isError(res)) {
+            throw std::runtime_error("Could not decompress SZ file: " + std::string(ZSTD_getErrorName(res)));
+        }
+        return;
     }
+
+    // Some frames (e.g. those of seekable files) don't store their size, so stream those instead
+    ZSTD_DCtx *dctx = ZSTD_createDCtx();
+    if (dctx == nullptr) {
+        throw std::runtime_error("Could not create decompression context");
+    }
+    data.resize(std::max(szSize * 4, ZSTD_DStreamOutSize()));
+    ZSTD_inBuffer input = { szData, szSize, 0 };
+    ZSTD_outBuffer output = { data.data(), data.size(), 0 };
+    // A result of 0 means the current frame is complete and flushed. Until then the
+    // decoder may still hold data even after all input was consumed.
+    size_t res = 1;
+    while (input.pos < input.size || res != 0) {
+        if (output.pos == output.size) {
+            data.resize(data.size() * 2);
+            output.dst = data.data();
+            output.size = data.size();
+        }
+        res = ZSTD_decompressStream(dctx, &output, &input);
+        if (ZSTD_isError(res)) {
+            ZSTD_freeDCtx(dctx);
+            throw std::runtime_error("Could not decompress SZ file: " + std::string(ZSTD_getErrorName(res)));
+        }
+        // No more input, and the decoder stopped with room left in the output
+        if (res != 0 && input.pos == input.size && output.pos < output.size) {
+            ZSTD_freeDCtx(dctx);
+            throw std::runtime_error("Could not decompress SZ file: truncated frame");
+        }
+    }
+    ZSTD_freeDCtx(dctx);
+
+    size = output.pos;
+    data.resize(size);
 }
 
 const u8 *ZSTD::GetData(size_t &size) const {
@@ -37,3 +84,132 @@ void ZSTD::Write(std::ostream &szFile, const u8 *data, size_t size, int compress
     }
     szFile.write((char *) buffer.data(), res);
 }
+
+void ZSTD::WriteSeekable(std::ostream &szFile, const u8 *data, size_t size, int compressionLevel, u32 frameSize) {
+    ZSTD_seekable_CStream *cstream = ZSTD_seekable_createCStream();
+    if (cstream == nullptr) {
+        throw std::runtime_error("Could not create seekable compression stream");
+    }
+
+    std::vector<u8> buffer(ZSTD_CStreamOutSize());
+    auto check = [&](size_t res) {
+        if (ZSTD_isError(res)) {
+            ZSTD_seekable_freeCStream(cstream);
+            throw std::runtime_error("Could not compress SZ file: " + std::string(ZSTD_getErrorName(res)));
+        }
+        return res;
+    };
+
+    check(ZSTD_seekable_initCStream(cstream, compressionLevel, 1, frameSize));
+
+    ZSTD_inBuffer input = { data, size, 0 };
+    while (input.pos < input.size) {
+        ZSTD_outBuffer output = { buffer.data(), buffer.size(), 0 };
+        check(ZSTD_seekable_compressStream(cstream, &output, &input));
+        szFile.write((char *) buffer.data(), output.pos);
+    }
+
+    size_t remaining;
+    do {
+        ZSTD_outBuffer output = { buffer.data(), buffer.size(), 0 };
+        remaining = check(ZSTD_seekable_endStream(cstream, &output));
+        szFile.write((char *) buffer.data(), output.pos);
+    } while (remaining != 0);
+
+    ZSTD_seekable_freeCStream(cstream);
+}
+
+bool ZSTD::IsSeekable(std::istream &szFile) {
+    // The seek table is stored in a skippable frame at the very end of the file,
+    // whose last four bytes are the seekable magic number
+    szFile.seekg(0, std::ios::end);
+    size_t szCompressedSize = szFile.tellg();
+    if (szCompressedSize < ZSTD_seekTableFooterSize) {
+        szFile.seekg(0, std::ios::beg);
+        return false;
+    }
+
+    u8 magic[4];
+    szFile.seekg(szCompressedSize - 4);
+    szFile.read((char *) magic, 4);
+    szFile.clear();
+    szFile.seekg(0, std::ios::beg);
+
+    u32 magicNumber = magic[0] | (magic[1] << 8) | (magic[2] << 16) | ((u32) magic[3] << 24);
+    return magicNumber == ZSTD_SEEKABLE_MAGICNUMBER;
+}
+
+ZSTDSeekable::ZSTDSeekable(std::istream &szFile) : szFile(szFile) {
+    seekable = ZSTD_seekable_create();
+    if (seekable == nullptr) {
+        throw std::runtime_error("Could not create seekable decompression stream");
+    }
+
+    ZSTD_seekable_customFile file = { this, ReadCallback, SeekCallback };
+    size_t res = ZSTD_seekable_initAdvanced(seekable, file);
+    if (ZSTD_isError(res)) {
+        ZSTD_seekable_free(seekable);
+        throw std::runtime_error("Could not read SZ seek table: " + std::string(ZSTD_getErrorName(res)));
+    }
+
+    unsigned numFrames = ZSTD_seekable_getNumFrames(seekable);
+    if (numFrames == 0) {
+        decompressedSize = 0;
+    } else {
+        decompressedSize = ZSTD_seekable_getFrameDecompressedOffset(seekable, numFrames - 1)
+                         + ZSTD_seekable_getFrameDecompressedSize(seekable, numFrames - 1);
+    }
+}
+
+ZSTDSeekable::~ZSTDSeekable() {
+    ZSTD_seekable_free(seekable);
+}
+
+size_t ZSTDSeekable::GetDecompressedSize() const {
+    return decompressedSize;
+}
+
+void ZSTDSeekable::Read(u8 *dest, size_t offset, size_t size) {
+    AINBY_PROFILE_SCOPE("ZSTDSeekable::Read");
+    if (offset + size > decompressedSize) {
+        throw std::runtime_error("Read past the end of SZ file");
+    }
+
+    // ZSTD_seekable_decompress may stop at a frame boundary, so keep going until everything is read
+    while (size > 0) {
+        size_t res = ZSTD_seekable_decompress(seekable, dest, size, offset);
+        if (ZSTD_isError(res)) {
+            throw std::runtime_error("Could not decompress SZ file: " + std::string(ZSTD_getErrorName(res)));
+        }
+        if (res == 0) {
+            throw std::runtime_error("Unexpected end of SZ file");
+        }
+        dest += res;
+        offset += res;
+        size -= res;
+    }
+}
+
+int ZSTDSeekable::ReadCallback(void *opaque, void *buffer, size_t n) {
+    std::istream &szFile = ((ZSTDSeekable *) opaque)->szFile;
+    szFile.read((char *) buffer, n);
+    if ((size_t) szFile.gcount() != n) {
+        szFile.clear();
+        return -1;
+    }
+    return 0;
+}
+
+int ZSTDSeekable::SeekCallback(void *opaque, long long offset, int origin) {
+    std::istream &szFile = ((ZSTDSeekable *) opaque)->szFile;
+    std::ios::seekdir dir;
+    switch (origin) {
+        case SEEK_SET: dir = std::ios::beg; break;
+        case SEEK_CUR: dir = std::ios::cur; break;
+        case SEEK_END: dir = std::ios::end; break;
+        default: return -1;
+    }
+    szFile.clear();
+    szFile.seekg(offset, dir);
+    return szFile.fail() ? -1 : 0;
+}
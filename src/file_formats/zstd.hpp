@@ -5,14 +5,43 @@
 
 #include "types.h"
 
+struct ZSTD_seekable_s;
+
 class ZSTD {
 public:
     void Read(std::istream &szFile);
+    void Read(const u8 *szData, size_t szSize);
     const u8 *GetData(size_t &size) const;
 
     static void Write(std::ostream &szFile, const u8 *data, size_t size, int compressionLevel = 19);
+    // Writes the data as independently compressed frames followed by a seek table,
+    // so that ZSTDSeekable can later decompress arbitrary ranges of it
+    static void WriteSeekable(std::ostream &szFile, const u8 *data, size_t size, int compressionLevel = 19, u32 frameSize = 0x10000);
+    static bool IsSeekable(std::istream &szFile);
 
 private:
     std::vector<u8> data;
     size_t size;
 };
+
+// Random access into a seekable SZ file, only the frames covering a requested
+// range are decompressed. The stream has to outlive this object.
+class ZSTDSeekable {
+public:
+    ZSTDSeekable(std::istream &szFile);
+    ~ZSTDSeekable();
+
+    ZSTDSeekable(const ZSTDSeekable &) = delete;
+    ZSTDSeekable &operator=(const ZSTDSeekable &) = delete;
+
+    size_t GetDecompressedSize() const;
+    void Read(u8 *dest, size_t offset, size_t size);
+
+private:
+    static int ReadCallback(void *opaque, void *buffer, size_t n);
+    static int SeekCallback(void *opaque, long long offset, int origin);
+
+    std::istream &szFile;
+    ZSTD_seekable_s *seekable;
+    size_t decompressedSize;
+};
@@ -0,0 +1,346 @@
+#include "ainb_index.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <strstream>
+#include <unordered_map>
+
+#include "file_formats/ainb.hpp"
+#include "file_formats/format.hpp"
+#include "file_formats/sarc.hpp"
+#include "util/thread_pool.hpp"
+#include "vfs/vfs.hpp"
+
+namespace fs = std::filesystem;
+
+#define INDEX_VERSION 1
+
+namespace {
+
+struct IndexedFile {
+    std::string path;
+    std::vector<std::string> terms[AINBIndex::TermKindCount];
+};
+
+bool EndsWith(const std::string &str, const char *suffix) {
+    size_t len = strlen(suffix);
+    return str.size() >= len && str.compare(str.size() - len, len, suffix) == 0;
+}
+
+// Only files that can contain AINBs are looked at, decompressing everything else would take forever
+bool IsCandidate(const std::string &path) {
+    static const char *extensions[] = { ".ainb", ".pack", ".sarc", ".ainb.zs", ".pack.zs", ".sarc.zs" };
+    for (const char *extension : extensions) {
+        if (EndsWith(path, extension)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+class IndexBuilder {
+public:
+    IndexBuilder(size_t threadCount) : pool(threadCount) {}
+
+    void Run(const fs::path &romfsRoot) {
+        for (const fs::directory_entry &entry : fs::recursive_directory_iterator(romfsRoot)) {
+            if (!entry.is_regular_file()) {
+                continue;
+            }
+            std::string path = fs::relative(entry.path(), romfsRoot).generic_string();
+            if (!IsCandidate(path)) {
+                continue;
+            }
+            Submit([this, path, hostPath = entry.path()] {
+                std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>(hostPath);
+                size_t size;
+                const u8 *data = file->GetData(size);
+                Process(path, data, size, file);
+            }, path);
+        }
+        pool.Wait();
+    }
+
+    std::vector<IndexedFile> files;
+    AINBIndex::BuildStats stats;
+
+private:
+    void Submit(std::function<void()> task, const std::string &path) {
+        pool.Submit([this, task = std::move(task), path] {
+            try {
+                task();
+            } catch (std::exception &e) {
+                std::lock_guard<std::mutex> lock(mutex);
+                std::cerr << path << ": " << e.what() << std::endl;
+                stats.errorCount++;
+            }
+        });
+    }
+
+    void Process(const std::string &path, const u8 *data, size_t size, std::shared_ptr<const void> backing) {
+        backing = UnwrapZSTD(data, size, backing, nullptr);
+
+        switch (DetectFormat(data, size)) {
+            case FileFormat::AINB:
+                IndexAINB(path, data, size);
+                break;
+            case FileFormat::SARC: {
+                SARC sarc;
+                sarc.Read(data, size);
+                for (const std::string &name : sarc.GetFileList()) {
+                    u32 fileSize;
+                    const u8 *fileData = sarc.GetFileByPath(name, fileSize);
+                    if (!IsCandidate(name) && DetectFormat(fileData, fileSize) != FileFormat::AINB) {
+                        continue;
+                    }
+                    // Every file becomes its own task, so that idle workers can steal from huge packs
+                    std::string filePath = path + "/" + name;
+                    Submit([this, filePath, fileData, fileSize, backing] {
+                        Process(filePath, fileData, fileSize, backing);
+                    }, filePath);
+                }
+                std::lock_guard<std::mutex> lock(mutex);
+                stats.archiveCount++;
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    void IndexAINB(const std::string &path, const u8 *data, size_t size) {
+        std::istrstream stream((const char *) data, size);
+        AINB ainb;
+        ainb.Read(stream);
+
+        IndexedFile file;
+        file.path = path;
+        std::vector<std::string> &nodeTypes = file.terms[(u32) AINBIndex::TermKind::NodeType];
+        std::vector<std::string> &params = file.terms[(u32) AINBIndex::TermKind::Param];
+        for (const AINB::Node &node : ainb.nodes) {
+            nodeTypes.push_back(node.TypeName());
+            for (const AINB::Param &param : node.GetParams()) {
+                params.push_back(param.name);
+            }
+        }
+        for (const AINB::Gparams::Gparam &gparam : ainb.gparams.gparams) {
+            file.terms[(u32) AINBIndex::TermKind::Gparam].push_back(gparam.name);
+        }
+        for (const AINB::EmbeddedAINB &embeddedAinb : ainb.embeddedAinbs) {
+            file.terms[(u32) AINBIndex::TermKind::EmbeddedAINB].push_back(embeddedAinb.name);
+        }
+        for (std::vector<std::string> &terms : file.terms) {
+            std::sort(terms.begin(), terms.end());
+            terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        files.push_back(std::move(file));
+        stats.ainbCount++;
+    }
+
+    ThreadPool pool;
+    std::mutex mutex;
+};
+
+} // namespace
+
+AINBIndex::BuildStats AINBIndex::Build(const fs::path &romfsRoot, const fs::path &indexPath, size_t threadCount) {
+    IndexBuilder builder(threadCount);
+    builder.Run(romfsRoot);
+
+    // Sorting makes the file IDs (and thus the whole index) deterministic
+    std::vector<IndexedFile> &files = builder.files;
+    std::sort(files.begin(), files.end(), [](const IndexedFile &a, const IndexedFile &b) {
+        return a.path < b.path;
+    });
+
+    std::string strings;
+    auto addString = [&](const std::string &str) {
+        u32 offset = strings.size();
+        strings += str;
+        return offset;
+    };
+
+    std::vector<FileRecord> fileRecords;
+    for (const IndexedFile &file : files) {
+        fileRecords.push_back({ addString(file.path), (u32) file.path.size() });
+    }
+
+    Header header = {};
+    memcpy(header.magic, "AIDX", 4);
+    header.version = INDEX_VERSION;
+    header.fileCount = files.size();
+    header.fileTableOffset = sizeof(Header);
+
+    std::vector<TermRecord> termRecords;
+    std::vector<u32> postings;
+    u32 termTableOffset = header.fileTableOffset + fileRecords.size() * sizeof(FileRecord);
+    for (u32 kind = 0; kind < TermKindCount; kind++) {
+        // Files are visited in ID order, so every posting list ends up sorted
+        std::unordered_map<std::string, std::vector<u32>> fileIDsByTerm;
+        for (u32 fileID = 0; fileID < files.size(); fileID++) {
+            for (const std::string &term : files[fileID].terms[kind]) {
+                fileIDsByTerm[term].push_back(fileID);
+            }
+        }
+        std::vector<std::string> terms;
+        for (const auto &[term, _] : fileIDsByTerm) {
+            terms.push_back(term);
+        }
+        std::sort(terms.begin(), terms.end());
+
+        header.termCounts[kind] = terms.size();
+        header.termTableOffsets[kind] = termTableOffset + termRecords.size() * sizeof(TermRecord);
+        for (const std::string &term : terms) {
+            const std::vector<u32> &fileIDs = fileIDsByTerm[term];
+            termRecords.push_back({ addString(term), (u32) term.size(), (u32) postings.size(), (u32) fileIDs.size() });
+            postings.insert(postings.end(), fileIDs.begin(), fileIDs.end());
+        }
+    }
+    header.postingsOffset = termTableOffset + termRecords.size() * sizeof(TermRecord);
+    header.stringsOffset = header.postingsOffset + postings.size() * sizeof(u32);
+
+    // Written to a temporary file first, so that a running query never sees a half written index
+    fs::path tempPath = indexPath;
+    tempPath += ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary);
+        out.write((const char *) &header, sizeof(Header));
+        out.write((const char *) fileRecords.data(), fileRecords.size() * sizeof(FileRecord));
+        out.write((const char *) termRecords.data(), termRecords.size() * sizeof(TermRecord));
+        out.write((const char *) postings.data(), postings.size() * sizeof(u32));
+        out.write(strings.data(), strings.size());
+        if (!out) {
+            throw std::runtime_error("Could not write index " + tempPath.string());
+        }
+    }
+    fs::rename(tempPath, indexPath);
+
+    return builder.stats;
+}
+
+void AINBIndex::Open(const fs::path &indexPath) {
+    file = MappedFile(indexPath);
+    data = file.GetData(size);
+
+    if (size < sizeof(Header) || memcmp(data, "AIDX", 4) != 0) {
+        throw std::runtime_error("Invalid AINB index magic");
+    }
+    header = (const Header *) data;
+    if (header->version != INDEX_VERSION) {
+        throw std::runtime_error("Unsupported AINB index version, rebuild the index");
+    }
+    Validate();
+}
+
+// Checks every table and record once, so that lookups can read the mapping without checks
+void AINBIndex::Validate() const {
+    auto check = [](bool ok) {
+        if (!ok) {
+            throw std::runtime_error("Truncated AINB index");
+        }
+    };
+    auto inRange = [](u64 offset, u64 length, u64 end) {
+        return offset <= end && length <= end - offset;
+    };
+
+    check(header->stringsOffset <= size && header->postingsOffset <= header->stringsOffset);
+    u64 stringsSize = size - header->stringsOffset;
+    u64 postingsCount = (header->stringsOffset - header->postingsOffset) / sizeof(u32);
+
+    check(inRange(header->fileTableOffset, (u64) header->fileCount * sizeof(FileRecord), size));
+    const FileRecord *files = (const FileRecord *) (data + header->fileTableOffset);
+    for (u32 i = 0; i < header->fileCount; i++) {
+        check(inRange(files[i].pathOffset, files[i].pathLength, stringsSize));
+    }
+
+    const u32 *postings = (const u32 *) (data + header->postingsOffset);
+    for (u32 kind = 0; kind < TermKindCount; kind++) {
+        check(inRange(header->termTableOffsets[kind], (u64) header->termCounts[kind] * sizeof(TermRecord), size));
+        const TermRecord *terms = GetTerms((TermKind) kind);
+        for (u32 i = 0; i < header->termCounts[kind]; i++) {
+            check(inRange(terms[i].nameOffset, terms[i].nameLength, stringsSize));
+            check(inRange(terms[i].postingsStart, terms[i].postingsCount, postingsCount));
+        }
+    }
+    for (u64 i = 0; i < postingsCount; i++) {
+        check(postings[i] < header->fileCount);
+    }
+}
+
+std::vector<std::string_view> AINBIndex::Find(TermKind kind, std::string_view term) const {
+    const TermRecord *begin = GetTerms(kind);
+    const TermRecord *end = begin + header->termCounts[(u32) kind];
+    const TermRecord *it = std::lower_bound(begin, end, term, [this](const TermRecord &record, std::string_view term) {
+        return GetString(record.nameOffset, record.nameLength) < term;
+    });
+
+    std::vector<std::string_view> paths;
+    if (it == end || GetString(it->nameOffset, it->nameLength) != term) {
+        return paths;
+    }
+    const u32 *postings = (const u32 *) (data + header->postingsOffset);
+    for (u32 i = 0; i < it->postingsCount; i++) {
+        paths.push_back(GetFilePath(postings[it->postingsStart + i]));
+    }
+    return paths;
+}
+
+std::vector<std::string_view> AINBIndex::FindTerms(TermKind kind, std::string_view part) const {
+    const TermRecord *terms = GetTerms(kind);
+    std::vector<std::string_view> result;
+    for (u32 i = 0; i < header->termCounts[(u32) kind]; i++) {
+        std::string_view name = GetString(terms[i].nameOffset, terms[i].nameLength);
+        if (name.find(part) != std::string_view::npos) {
+            result.push_back(name);
+        }
+    }
+    return result;
+}
+
+size_t AINBIndex::GetFileCount() const {
+    return header->fileCount;
+}
+
+size_t AINBIndex::GetTermCount(TermKind kind) const {
+    return header->termCounts[(u32) kind];
+}
+
+std::string_view AINBIndex::GetFilePath(u32 fileID) const {
+    const FileRecord *files = (const FileRecord *) (data + header->fileTableOffset);
+    return GetString(files[fileID].pathOffset, files[fileID].pathLength);
+}
+
+const char *AINBIndex::TermKindName(TermKind kind) {
+    switch (kind) {
+        case TermKind::NodeType: return "nodetype";
+        case TermKind::Param: return "param";
+        case TermKind::Gparam: return "gparam";
+        case TermKind::EmbeddedAINB: return "embedded";
+        default: return "unknown";
+    }
+}
+
+bool AINBIndex::ParseTermKind(std::string_view name, TermKind &kind) {
+    for (u32 i = 0; i < TermKindCount; i++) {
+        if (name == TermKindName((TermKind) i)) {
+            kind = (TermKind) i;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string_view AINBIndex::GetString(u32 offset, u32 length) const {
+    return std::string_view((const char *) data + header->stringsOffset + offset, length);
+}
+
+const AINBIndex::TermRecord *AINBIndex::GetTerms(TermKind kind) const {
+    return (const TermRecord *) (data + header->termTableOffsets[(u32) kind]);
+}
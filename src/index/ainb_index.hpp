@@ -0,0 +1,85 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "types.h"
+#include "util/mapped_file.hpp"
+
+// Inverted index over all AINB files of a romfs dump, mapping node type names,
+// parameter names, global parameter names and embedded AINB references to the
+// files using them. File paths are VFS paths, e.g. "Pack/Actor/Foo.pack.zs/AI/Bar.root.ainb".
+//
+// The index file is used directly through a memory mapping:
+//   Header
+//   FileRecord[fileCount]                           (sorted by path)
+//   TermRecord[termCounts[kind]] for every kind     (sorted by name)
+//   u32 postings[]                                  (file IDs, sorted per term)
+//   char strings[]
+class AINBIndex {
+public:
+    enum class TermKind {
+        NodeType,
+        Param,
+        Gparam,
+        EmbeddedAINB,
+        _Count
+    };
+    static const u32 TermKindCount = static_cast<u32>(TermKind::_Count);
+
+    struct BuildStats {
+        size_t ainbCount = 0;
+        size_t archiveCount = 0;
+        size_t errorCount = 0;
+    };
+
+    // Parses every AINB in the romfs dump (also inside of archives) and writes the index
+    static BuildStats Build(const std::filesystem::path &romfsRoot, const std::filesystem::path &indexPath, size_t threadCount);
+
+    void Open(const std::filesystem::path &indexPath);
+
+    // Files using exactly this term
+    std::vector<std::string_view> Find(TermKind kind, std::string_view term) const;
+    // Terms containing the given string
+    std::vector<std::string_view> FindTerms(TermKind kind, std::string_view part) const;
+
+    size_t GetFileCount() const;
+    size_t GetTermCount(TermKind kind) const;
+    std::string_view GetFilePath(u32 fileID) const;
+
+    static const char *TermKindName(TermKind kind);
+    static bool ParseTermKind(std::string_view name, TermKind &kind);
+
+private:
+    struct Header {
+        char magic[4];
+        u32 version;
+        u32 fileCount;
+        u32 fileTableOffset;
+        u32 termCounts[TermKindCount];
+        u32 termTableOffsets[TermKindCount];
+        u32 postingsOffset;
+        u32 stringsOffset;
+    };
+    struct FileRecord {
+        u32 pathOffset;
+        u32 pathLength;
+    };
+    struct TermRecord {
+        u32 nameOffset;
+        u32 nameLength;
+        u32 postingsStart;
+        u32 postingsCount;
+    };
+
+    void Validate() const;
+    std::string_view GetString(u32 offset, u32 length) const;
+    const TermRecord *GetTerms(TermKind kind) const;
+
+    MappedFile file;
+    const u8 *data = nullptr;
+    size_t size = 0;
+    const Header *header = nullptr;
+};
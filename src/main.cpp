@@ -5,19 +5,42 @@
 #include <SDL3/SDL.h>
 #include <SDL3/SDL_opengl.h>
 
+#include <cstring>
+#include <stdexcept>
+
 #ifdef WIN32
 #include <ShellScalingAPI.h>
 #include <Windows.h>
 #endif
 
 #include "ainby.hpp"
+#include "util/profiler.hpp"
 
 #define AINBY_VERSION "v0.1-beta"
 
+// Frames still drawn after the last event, ImGui needs a few to settle
+// (e.g. popups only open on the frame after they are requested)
+#define SETTLE_FRAMES 3
+// How long an idle loop sleeps at most, while typing this keeps the text cursor blinking
+#define IDLE_TIMEOUT_MS 500
+
 static const char* ImGuiGetClipboardText(void *) { return SDL_GetClipboardText(); }
 static void ImGuiSetClipboardText(void *, const char *text) { SDL_SetClipboardText(text); }
 
-int main() {
+int main(int argc, char **argv) {
+    AINBY_PROFILE_THREAD("Main");
+#ifdef AINBY_PROFILER
+    // Records the whole session, including startup, e.g. to compare it with one on another machine
+    if (argc == 3 && strcmp(argv[1], "--trace") == 0) {
+        try {
+            Profiler::StartTrace(argv[2]);
+        } catch (std::exception &e) {
+            fprintf(stderr, "%s\n", e.what());
+            return -1;
+        }
+    }
+#endif
+
     // Setup SDL
     if (SDL_Init(SDL_INIT_VIDEO) != 0) {
         fprintf(stderr, "SDL Init Error: %s\n", SDL_GetError());
@@ -96,28 +119,49 @@ int main() {
     // Render loop
     AINBY ainby;
     bool shouldClose = false;
+    int settleFrames = SETTLE_FRAMES;
     while (!shouldClose && !ainby.shouldClose) {
+        // Nothing changes without input while idle, so instead of redrawing the
+        // same frame at the refresh rate, the loop sleeps until the next event
+        bool idle = settleFrames == 0 && !ainby.IsBusy();
         SDL_Event event;
-        while (SDL_PollEvent(&event)) {
+        bool hasEvent = idle ? SDL_WaitEventTimeout(&event, IDLE_TIMEOUT_MS) : SDL_PollEvent(&event);
+        if (idle && !hasEvent && !io.WantTextInput) {
+            continue;
+        }
+        while (hasEvent) {
             ImGui_ImplSDL3_ProcessEvent(&event);
             if (event.type == SDL_EVENT_QUIT)
                 shouldClose = true;
             if (event.type == SDL_EVENT_WINDOW_CLOSE_REQUESTED && event.window.windowID == SDL_GetWindowID(window))
                 shouldClose = true;
+            settleFrames = SETTLE_FRAMES;
+            hasEvent = SDL_PollEvent(&event);
+        }
+        if (settleFrames > 0) {
+            settleFrames--;
         }
 
+        AINBY_PROFILE_FRAME();
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplSDL3_NewFrame();
         ImGui::NewFrame();
 
         ainby.Draw();
 
-        ImGui::Render();
-        glViewport(0, 0, (int)io.DisplaySize.x, (int)io.DisplaySize.y);
-        glClearColor(0.45f, 0.55f, 0.60f, 1.00f);
-        glClear(GL_COLOR_BUFFER_BIT);
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-        SDL_GL_SwapWindow(window);
+        {
+            AINBY_PROFILE_SCOPE("Render");
+            ImGui::Render();
+            glViewport(0, 0, (int)io.DisplaySize.x, (int)io.DisplaySize.y);
+            glClearColor(0.45f, 0.55f, 0.60f, 1.00f);
+            glClear(GL_COLOR_BUFFER_BIT);
+            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        }
+        {
+            // Includes waiting for vsync
+            AINBY_PROFILE_SCOPE("SwapWindow");
+            SDL_GL_SwapWindow(window);
+        }
     }
 
     ImGui_ImplOpenGL3_Shutdown();
@@ -128,5 +172,8 @@ int main() {
     SDL_DestroyWindow(window);
     SDL_Quit();
 
+#ifdef AINBY_PROFILER
+    Profiler::StopTrace();
+#endif
     return 0;
 }
@@ -4,6 +4,14 @@
 # include "imgui_canvas.h"
 # include <type_traits>
 
+# if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#     define IMGUI_EX_CANVAS_SSE2 1
+#     include <emmintrin.h>
+# elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#     define IMGUI_EX_CANVAS_NEON 1
+#     include <arm_neon.h>
+# endif
+
 // https://stackoverflow.com/a/36079786
 # define DECLARE_HAS_MEMBER(__trait_name__, __member_name__)                         \
                                                                                      \
@@ -90,6 +98,72 @@ static inline unsigned int& ImVtxOffsetRef(ImDrawList* drawList)
     return VtxCurrentOffsetRef::Get<ImDrawList>(drawList);
 }
 
+// Vertices are 20 bytes apart, positions of two vertices are gathered into
+// one register. Wider vectors don't pay off without scatter stores.
+void ImGuiEx::TransformVertices(ImDrawVert* begin, ImDrawVert* end, float scale, const ImVec2& offset)
+{
+    auto vertex = begin;
+
+# if defined(IMGUI_EX_CANVAS_SSE2)
+    const auto s = _mm_set1_ps(scale);
+    const auto o = _mm_setr_ps(offset.x, offset.y, offset.x, offset.y);
+    for (; end - vertex >= 4; vertex += 4)
+    {
+        auto a = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64*>(&vertex[0].pos)), reinterpret_cast<const __m64*>(&vertex[1].pos));
+        auto b = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64*>(&vertex[2].pos)), reinterpret_cast<const __m64*>(&vertex[3].pos));
+        a = _mm_add_ps(_mm_mul_ps(a, s), o);
+        b = _mm_add_ps(_mm_mul_ps(b, s), o);
+        _mm_storel_pi(reinterpret_cast<__m64*>(&vertex[0].pos), a);
+        _mm_storeh_pi(reinterpret_cast<__m64*>(&vertex[1].pos), a);
+        _mm_storel_pi(reinterpret_cast<__m64*>(&vertex[2].pos), b);
+        _mm_storeh_pi(reinterpret_cast<__m64*>(&vertex[3].pos), b);
+    }
+# elif defined(IMGUI_EX_CANVAS_NEON)
+    const auto s = vdupq_n_f32(scale);
+    const auto o = vcombine_f32(vld1_f32(&offset.x), vld1_f32(&offset.x));
+    for (; end - vertex >= 4; vertex += 4)
+    {
+        auto a = vcombine_f32(vld1_f32(&vertex[0].pos.x), vld1_f32(&vertex[1].pos.x));
+        auto b = vcombine_f32(vld1_f32(&vertex[2].pos.x), vld1_f32(&vertex[3].pos.x));
+        a = vaddq_f32(vmulq_f32(a, s), o);
+        b = vaddq_f32(vmulq_f32(b, s), o);
+        vst1_f32(&vertex[0].pos.x, vget_low_f32(a));
+        vst1_f32(&vertex[1].pos.x, vget_high_f32(a));
+        vst1_f32(&vertex[2].pos.x, vget_low_f32(b));
+        vst1_f32(&vertex[3].pos.x, vget_high_f32(b));
+    }
+# endif
+
+    for (; vertex < end; ++vertex)
+    {
+        vertex->pos.x = vertex->pos.x * scale + offset.x;
+        vertex->pos.y = vertex->pos.y * scale + offset.y;
+    }
+}
+
+void ImGuiEx::TransformClipRects(ImDrawCmd* begin, ImDrawCmd* end, float scale, const ImVec2& offset)
+{
+# if defined(IMGUI_EX_CANVAS_SSE2)
+    const auto s = _mm_set1_ps(scale);
+    const auto o = _mm_setr_ps(offset.x, offset.y, offset.x, offset.y);
+    for (auto command = begin; command < end; ++command)
+        _mm_storeu_ps(&command->ClipRect.x, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&command->ClipRect.x), s), o));
+# elif defined(IMGUI_EX_CANVAS_NEON)
+    const auto s = vdupq_n_f32(scale);
+    const auto o = vcombine_f32(vld1_f32(&offset.x), vld1_f32(&offset.x));
+    for (auto command = begin; command < end; ++command)
+        vst1q_f32(&command->ClipRect.x, vaddq_f32(vmulq_f32(vld1q_f32(&command->ClipRect.x), s), o));
+# else
+    for (auto command = begin; command < end; ++command)
+    {
+        command->ClipRect.x = command->ClipRect.x * scale + offset.x;
+        command->ClipRect.y = command->ClipRect.y * scale + offset.y;
+        command->ClipRect.z = command->ClipRect.z * scale + offset.x;
+        command->ClipRect.w = command->ClipRect.w * scale + offset.y;
+    }
+# endif
+}
+
 static inline ImVec2 ImSelectPositive(const ImVec2& lhs, const ImVec2& rhs) { return ImVec2(lhs.x > 0.0f ? lhs.x : rhs.x, lhs.y > 0.0f ? lhs.y : rhs.y); }
 
 bool ImGuiEx::Canvas::Begin(const char* id, const ImVec2& size)
@@ -512,45 +586,10 @@ void ImGuiEx::Canvas::LeaveLocalSpace()
     auto vertex    = m_DrawList->VtxBuffer.Data + m_DrawListStartVertexIndex;
     auto vertexEnd = m_DrawList->VtxBuffer.Data + m_DrawList->_VtxCurrentIdx + ImVtxOffsetRef(m_DrawList);
 
-    // If canvas view is not scaled take a faster path.
-    if (m_View.Scale != 1.0f)
-    {
-        while (vertex < vertexEnd)
-        {
-            vertex->pos.x = vertex->pos.x * m_View.Scale + m_ViewTransformPosition.x;
-            vertex->pos.y = vertex->pos.y * m_View.Scale + m_ViewTransformPosition.y;
-            ++vertex;
-        }
-
-        // Move clip rectangles to screen space.
-        for (int i = m_DrawListCommadBufferSize; i < m_DrawList->CmdBuffer.size(); ++i)
-        {
-            auto& command = m_DrawList->CmdBuffer[i];
-            command.ClipRect.x = command.ClipRect.x * m_View.Scale + m_ViewTransformPosition.x;
-            command.ClipRect.y = command.ClipRect.y * m_View.Scale + m_ViewTransformPosition.y;
-            command.ClipRect.z = command.ClipRect.z * m_View.Scale + m_ViewTransformPosition.x;
-            command.ClipRect.w = command.ClipRect.w * m_View.Scale + m_ViewTransformPosition.y;
-        }
-    }
-    else
-    {
-        while (vertex < vertexEnd)
-        {
-            vertex->pos.x = vertex->pos.x + m_ViewTransformPosition.x;
-            vertex->pos.y = vertex->pos.y + m_ViewTransformPosition.y;
-            ++vertex;
-        }
-
-        // Move clip rectangles to screen space.
-        for (int i = m_DrawListCommadBufferSize; i < m_DrawList->CmdBuffer.size(); ++i)
-        {
-            auto& command = m_DrawList->CmdBuffer[i];
-            command.ClipRect.x = command.ClipRect.x + m_ViewTransformPosition.x;
-            command.ClipRect.y = command.ClipRect.y + m_ViewTransformPosition.y;
-            command.ClipRect.z = command.ClipRect.z + m_ViewTransformPosition.x;
-            command.ClipRect.w = command.ClipRect.w + m_ViewTransformPosition.y;
-        }
-    }
+    TransformVertices(vertex, vertexEnd, m_View.Scale, m_ViewTransformPosition);
+
+    // Move clip rectangles to screen space.
+    TransformClipRects(m_DrawList->CmdBuffer.Data + m_DrawListCommadBufferSize, m_DrawList->CmdBuffer.Data + m_DrawList->CmdBuffer.Size, m_View.Scale, m_ViewTransformPosition);
 
     // Remove sentinel draw command if present
     if (m_DrawListCommadBufferSize > 0)
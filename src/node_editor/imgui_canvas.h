@@ -57,6 +57,12 @@
 
 namespace ImGuiEx {
 
+// Applies `position * scale + offset` in place to vertex positions and
+// clip rectangles of draw commands. This is how canvas content gets moved
+// to screen space, uses SSE2 or NEON if the target has them.
+IMGUIEX_CANVAS_API void TransformVertices(ImDrawVert* begin, ImDrawVert* end, float scale, const ImVec2& offset);
+IMGUIEX_CANVAS_API void TransformClipRects(ImDrawCmd* begin, ImDrawCmd* end, float scale, const ImVec2& offset);
+
 struct CanvasView
 {
     ImVec2 Origin;
@@ -10,6 +10,7 @@
 //   Written by Michal Cichon
 //------------------------------------------------------------------------------
 # include "imgui_node_editor_internal.h"
+# include "util/profiler.hpp"
 # include <cstdio> // snprintf
 # include <string>
 # include <fstream>
@@ -126,6 +127,10 @@ static const float c_NavigationZoomMargin       = 0.1f;  // percentage of visibl
 static const float c_MouseZoomDuration          = 0.15f; // seconds
 static const float c_SelectionFadeOutDuration   = 0.15f; // seconds
 
+static const float c_GridCellSize               = 256.0f; // canvas pixels
+static const int   c_GridMaxCellsPerObject      = 64;
+static const float c_GridCoordinateLimit        = 1.0e8f; // canvas pixels
+
 static const auto  c_MaxMoveOverEdgeSpeed       = 10.0f;
 static const auto  c_MaxMoveOverEdgeDistance    = 300.0f;
 
@@ -244,6 +249,28 @@ static void ImDrawList_SwapChannels(ImDrawList* drawList, int left, int right)
     ImDrawListSplitter_SwapChannels(&drawList->_Splitter, left, right);
 }
 
+static bool ImDrawChannel_IsEmpty(const ImDrawChannel& channel)
+{
+    for (const auto& cmd : channel._CmdBuffer)
+        if (cmd.ElemCount > 0 || cmd.UserCallback != nullptr)
+            return false;
+
+    return true;
+}
+
+// Moves channel order[i] to index i, for the first count channels. Channels are
+// moved bitwise, scratch only holds them temporarily and never owns their buffers.
+static void ImDrawListSplitter_PermuteChannels(ImDrawListSplitter* splitter, const int* order, int count, ImVector<ImDrawChannel>& scratch)
+{
+    IM_ASSERT(count <= splitter->_Channels.Size);
+    IM_ASSERT(order[splitter->_Current] == splitter->_Current); // Current channel lives in the draw list
+
+    scratch.resize(count);
+    for (int i = 0; i < count; ++i)
+        memcpy(&scratch.Data[i], &splitter->_Channels.Data[order[i]], sizeof(ImDrawChannel));
+    memcpy(splitter->_Channels.Data, scratch.Data, count * sizeof(ImDrawChannel));
+}
+
 static void ImDrawList_SwapSplitter(ImDrawList* drawList, ImDrawListSplitter& splitter)
 {
     auto& currentSplitter = drawList->_Splitter;
@@ -468,7 +495,8 @@ static void ImDrawList_PolyFillScanFlood(ImDrawList *draw, std::vector<ImVec2>*
 
 static void ImDrawList_AddBezierWithArrows(ImDrawList* drawList, const ImCubicBezierPoints& curve, float thickness,
     float startArrowSize, float startArrowWidth, float endArrowSize, float endArrowWidth,
-    bool fill, ImU32 color, float strokeThickness, const ImVec2* startDirHint = nullptr, const ImVec2* endDirHint = nullptr)
+    bool fill, ImU32 color, float strokeThickness, const ImVec2* startDirHint = nullptr, const ImVec2* endDirHint = nullptr,
+    const ImVec2* polyline = nullptr, int polylineCount = 0)
 {
     using namespace ax;
 
@@ -479,7 +507,11 @@ static void ImDrawList_AddBezierWithArrows(ImDrawList* drawList, const ImCubicBe
 
     if (fill)
     {
-        drawList->AddBezierCubic(curve.P0, curve.P1, curve.P2, curve.P3, color, thickness);
+        // Curve already tessellated by the caller
+        if (polyline)
+            drawList->AddPolyline(polyline, polylineCount, color, 0, thickness);
+        else
+            drawList->AddBezierCubic(curve.P0, curve.P1, curve.P2, curve.P3, color, thickness);
 
         if (startArrowSize > 0.0f)
         {
@@ -548,6 +580,125 @@ static void ImDrawList_AddBezierWithArrows(ImDrawList* drawList, const ImCubicBe
 
 
 
+//------------------------------------------------------------------------------
+//
+// Spatial Grid
+//
+//------------------------------------------------------------------------------
+ed::SpatialGrid::Range ed::SpatialGrid::CalcRange(const ImRect& bounds)
+{
+    auto toCell = [](float p)
+    {
+        return static_cast<int>(ImFloor(ImClamp(p, -c_GridCoordinateLimit, c_GridCoordinateLimit) / c_GridCellSize));
+    };
+
+    Range range;
+    range.MinX = toCell(bounds.Min.x);
+    range.MinY = toCell(bounds.Min.y);
+    range.MaxX = toCell(bounds.Max.x);
+    range.MaxY = toCell(bounds.Max.y);
+    return range;
+}
+
+void ed::SpatialGrid::Update(Object* object, const ImRect& bounds)
+{
+    const auto range = ImRect_IsEmpty(bounds) ? Range() : CalcRange(bounds);
+    if (range == object->m_GridRange)
+        return;
+
+    Remove(object);
+
+    object->m_GridRange = range;
+    if (range.IsEmpty())
+        return;
+
+    if (range.CellCount() > c_GridMaxCellsPerObject)
+    {
+        m_LargeObjects.push_back(object);
+        return;
+    }
+
+    for (int y = range.MinY; y <= range.MaxY; ++y)
+        for (int x = range.MinX; x <= range.MaxX; ++x)
+            m_Cells[CellKey(x, y)].push_back(object);
+}
+
+void ed::SpatialGrid::Remove(Object* object)
+{
+    const auto range = object->m_GridRange;
+    if (range.IsEmpty())
+        return;
+
+    object->m_GridRange = Range();
+
+    static auto eraseFrom = [](vector<Object*>& objects, Object* object)
+    {
+        auto it = std::find(objects.begin(), objects.end(), object);
+        if (it == objects.end())
+            return;
+        *it = objects.back();
+        objects.pop_back();
+    };
+
+    if (range.CellCount() > c_GridMaxCellsPerObject)
+    {
+        eraseFrom(m_LargeObjects, object);
+        return;
+    }
+
+    // Empty cells are kept around, objects moving back and forth would only reallocate them
+    for (int y = range.MinY; y <= range.MaxY; ++y)
+        for (int x = range.MinX; x <= range.MaxX; ++x)
+        {
+            auto cell = m_Cells.find(CellKey(x, y));
+            if (cell != m_Cells.end())
+                eraseFrom(cell->second, object);
+        }
+}
+
+void ed::SpatialGrid::Query(const ImRect& rect, vector<Object*>& result)
+{
+    // Objects spanning multiple cells are only reported once
+    ++m_QueryMark;
+    auto add = [this, &result](const vector<Object*>& objects)
+    {
+        for (auto object : objects)
+        {
+            if (object->m_GridQueryMark == m_QueryMark)
+                continue;
+            object->m_GridQueryMark = m_QueryMark;
+            result.push_back(object);
+        }
+    };
+
+    add(m_LargeObjects);
+
+    const auto range = CalcRange(rect);
+    if (range.CellCount() > static_cast<long long>(m_Cells.size()))
+    {
+        // Rectangle covers more cells than there are in use
+        for (auto& cell : m_Cells)
+        {
+            const int x = static_cast<int>(static_cast<ImU32>(cell.first >> 32));
+            const int y = static_cast<int>(static_cast<ImU32>(cell.first));
+            if (x >= range.MinX && x <= range.MaxX && y >= range.MinY && y <= range.MaxY)
+                add(cell.second);
+        }
+        return;
+    }
+
+    for (int y = range.MinY; y <= range.MaxY; ++y)
+        for (int x = range.MinX; x <= range.MaxX; ++x)
+        {
+            auto cell = m_Cells.find(CellKey(x, y));
+            if (cell != m_Cells.end())
+                add(cell->second);
+        }
+}
+
+
+
+
 //------------------------------------------------------------------------------
 //
 // Pin
@@ -555,7 +706,7 @@ static void ImDrawList_AddBezierWithArrows(ImDrawList* drawList, const ImCubicBe
 //------------------------------------------------------------------------------
 void ed::Pin::Draw(ImDrawList* drawList, DrawFlags flags)
 {
-    if (flags & Hovered)
+    if ((flags & Hovered) && m_Node->m_Channel >= 0)
     {
         drawList->ChannelsSetCurrent(m_Node->m_Channel + c_NodePinChannel);
 
@@ -635,6 +786,8 @@ void ed::Node::UpdateDrag(const ImVec2& offset)
     auto size = m_Bounds.GetSize();
     m_Bounds.Min = ImFloor(m_DragStart + offset);
     m_Bounds.Max = m_Bounds.Min + size;
+
+    Editor->UpdateSpatialIndex(this);
 }
 
 bool ed::Node::EndDrag()
@@ -644,6 +797,10 @@ bool ed::Node::EndDrag()
 
 void ed::Node::Draw(ImDrawList* drawList, DrawFlags flags)
 {
+    // Skipped nodes have no channels to draw into
+    if (m_Channel < 0)
+        return;
+
     if (flags == Detail::Object::None)
     {
         drawList->ChannelsSetCurrent(m_Channel + c_NodeBackgroundChannel);
@@ -911,10 +1068,11 @@ void ed::Link::Draw(ImDrawList* drawList, DrawFlags flags)
 
 void ed::Link::Draw(ImDrawList* drawList, ImU32 color, float extraThickness) const
 {
-    if (!m_IsLive)
+    if (!m_IsLive || m_IsCulled)
         return;
 
-    const auto curve = GetCurve();
+    const auto& curve    = GetCurve();
+    const auto& polyline = GetPolyline(drawList);
 
     ImDrawList_AddBezierWithArrows(drawList, curve, m_Thickness + extraThickness,
         m_StartPin && m_StartPin->m_ArrowSize  > 0.0f ? m_StartPin->m_ArrowSize  + extraThickness : 0.0f,
@@ -923,7 +1081,8 @@ void ed::Link::Draw(ImDrawList* drawList, ImU32 color, float extraThickness) con
           m_EndPin &&   m_EndPin->m_ArrowWidth > 0.0f ?   m_EndPin->m_ArrowWidth + extraThickness : 0.0f,
         true, color, 1.0f,
         m_StartPin && m_StartPin->m_SnapLinkToDir ? &m_StartPin->m_Dir : nullptr,
-        m_EndPin   &&   m_EndPin->m_SnapLinkToDir ?   &m_EndPin->m_Dir : nullptr);
+        m_EndPin   &&   m_EndPin->m_SnapLinkToDir ?   &m_EndPin->m_Dir : nullptr,
+        polyline.data(), static_cast<int>(polyline.size()));
 }
 
 void ed::Link::UpdateEndpoints()
@@ -931,9 +1090,44 @@ void ed::Link::UpdateEndpoints()
     const auto line = m_StartPin->GetClosestLine(m_EndPin);
     m_Start = line.A;
     m_End   = line.B;
+
+    // Everything derived from the curve is kept until it actually changes,
+    // so links between nodes that didn't move are not tessellated again
+    const auto curve = CalculateCurve();
+    const auto isCurveSame = curve.P0 == m_Curve.P0 && curve.P1 == m_Curve.P1 && curve.P2 == m_Curve.P2 && curve.P3 == m_Curve.P3;
+    if (isCurveSame && m_StartPin->m_ArrowSize == m_BoundsStartArrowSize && m_EndPin->m_ArrowSize == m_BoundsEndArrowSize)
+        return;
+
+    if (!isCurveSame)
+        m_PolylineTessellationTol = -1.0f;
+
+    m_Curve         = curve;
+    m_IsBoundsValid = false;
 }
 
-ImCubicBezierPoints ed::Link::GetCurve() const
+const ImCubicBezierPoints& ed::Link::GetCurve() const
+{
+    return m_Curve;
+}
+
+const ed::vector<ImVec2>& ed::Link::GetPolyline(ImDrawList* drawList) const
+{
+    const auto tolerance = drawList->_Data->CurveTessellationTol;
+    if (m_PolylineTessellationTol != tolerance)
+    {
+        // Same tessellation as ImDrawList::AddBezierCubic()
+        drawList->PathLineTo(m_Curve.P0);
+        drawList->PathBezierCubicCurveTo(m_Curve.P1, m_Curve.P2, m_Curve.P3);
+        m_Polyline.assign(drawList->_Path.begin(), drawList->_Path.end());
+        drawList->PathClear();
+
+        m_PolylineTessellationTol = tolerance;
+    }
+
+    return m_Polyline;
+}
+
+ImCubicBezierPoints ed::Link::CalculateCurve() const
 {
     auto easeLinkStrength = [](const ImVec2& a, const ImVec2& b, float strength)
     {
@@ -964,7 +1158,7 @@ ImCubicBezierPoints ed::Link::GetCurve() const
 
 bool ed::Link::TestHit(const ImVec2& point, float extraThickness) const
 {
-    if (!m_IsLive)
+    if (!m_IsLive || m_IsCulled)
         return false;
 
     auto bounds = GetBounds();
@@ -974,7 +1168,7 @@ bool ed::Link::TestHit(const ImVec2& point, float extraThickness) const
     if (!bounds.Contains(point))
         return false;
 
-    const auto bezier = GetCurve();
+    const auto& bezier = GetCurve();
     const auto result = ImProjectOnCubicBezier(point, bezier.P0, bezier.P1, bezier.P2, bezier.P3, 50);
 
     return result.Distance <= m_Thickness + extraThickness;
@@ -982,7 +1176,7 @@ bool ed::Link::TestHit(const ImVec2& point, float extraThickness) const
 
 bool ed::Link::TestHit(const ImRect& rect, bool allowIntersect) const
 {
-    if (!m_IsLive)
+    if (!m_IsLive || m_IsCulled)
         return false;
 
     const auto bounds = GetBounds();
@@ -993,7 +1187,7 @@ bool ed::Link::TestHit(const ImRect& rect, bool allowIntersect) const
     if (!allowIntersect || !rect.Overlaps(bounds))
         return false;
 
-    const auto bezier = GetCurve();
+    const auto& bezier = GetCurve();
 
     const auto p0 = rect.GetTL();
     const auto p1 = rect.GetTR();
@@ -1016,7 +1210,10 @@ ImRect ed::Link::GetBounds() const
 {
     if (m_IsLive)
     {
-        const auto curve = GetCurve();
+        if (m_IsBoundsValid)
+            return m_Bounds;
+
+        const auto& curve = GetCurve();
         auto bounds = ImCubicBezierBoundingRect(curve.P0, curve.P1, curve.P2, curve.P3);
 
         if (bounds.GetWidth() == 0.0f)
@@ -1053,6 +1250,11 @@ ImRect ed::Link::GetBounds() const
             bounds.Add(arrowBounds);
         }
 
+        m_Bounds               = bounds;
+        m_BoundsStartArrowSize = m_StartPin->m_ArrowSize;
+        m_BoundsEndArrowSize   = m_EndPin->m_ArrowSize;
+        m_IsBoundsValid        = true;
+
         return bounds;
     }
     else
@@ -1079,8 +1281,11 @@ ed::EditorContext::EditorContext(const ax::NodeEditor::Config* config)
     , m_Nodes()
     , m_Pins()
     , m_Links()
+    , m_SortedPinCount(0)
+    , m_SortedLinkCount(0)
     , m_SelectionId(1)
     , m_LastActiveLink(nullptr)
+    , m_LastActiveNode(nullptr)
     , m_Canvas()
     , m_IsCanvasVisible(false)
     , m_NodeBuilder(this)
@@ -1125,6 +1330,7 @@ ed::EditorContext::~EditorContext()
 
 void ed::EditorContext::Begin(const char* id, const ImVec2& size)
 {
+    AINBY_PROFILE_SCOPE("EditorContext::Begin");
     m_EditorActiveId = ImGui::GetID(id);
     ImGui::PushID(id);
 
@@ -1148,12 +1354,15 @@ void ed::EditorContext::Begin(const char* id, const ImVec2& size)
     //ImGui::LogToClipboard();
     //Log("---- begin ----");
 
-    static auto resetAndCollect = [](auto& objects)
+    static auto resetAndCollect = [](auto& objects, auto& index, SpatialGrid* grid)
     {
-        objects.erase(std::remove_if(objects.begin(), objects.end(), [](auto objectWrapper)
+        objects.erase(std::remove_if(objects.begin(), objects.end(), [&index, grid](auto objectWrapper)
         {
             if (objectWrapper->m_DeleteOnNewFrame)
             {
+                index.erase(objectWrapper.m_ID.Get());
+                if (grid)
+                    grid->Remove(objectWrapper.m_Object);
                 delete objectWrapper.m_Object;
                 return true;
             }
@@ -1165,9 +1374,23 @@ void ed::EditorContext::Begin(const char* id, const ImVec2& size)
         }), objects.end());
     };
 
-    resetAndCollect(m_Nodes);
-    resetAndCollect(m_Pins);
-    resetAndCollect(m_Links);
+    // Objects created outside of Begin()/End() still need to be merged in
+    SortNewObjects();
+
+    if (m_LastActiveNode && m_LastActiveNode->m_DeleteOnNewFrame)
+        m_LastActiveNode = nullptr;
+
+    resetAndCollect(m_Nodes, m_NodeIndex, &m_NodeGrid);
+    resetAndCollect(m_Pins,  m_PinIndex,  nullptr);
+    resetAndCollect(m_Links, m_LinkIndex, &m_LinkGrid);
+    m_SortedPinCount  = static_cast<int>(m_Pins.size());
+    m_SortedLinkCount = static_cast<int>(m_Links.size());
+
+    // Drawing order of nodes and links, used to order results of spatial queries
+    for (int i = 0; i < static_cast<int>(m_Nodes.size()); ++i)
+        m_Nodes[i]->m_OrderIndex = i;
+    for (int i = 0; i < static_cast<int>(m_Links.size()); ++i)
+        m_Links[i]->m_OrderIndex = i;
 
     m_DrawList = ImGui::GetWindowDrawList();
 
@@ -1252,6 +1475,9 @@ void ed::EditorContext::Begin(const char* id, const ImVec2& size)
 
 void ed::EditorContext::End()
 {
+    AINBY_PROFILE_SCOPE("EditorContext::End");
+    SortNewObjects();
+
     //auto& io          = ImGui::GetIO();
     auto  control     = BuildControl(m_CurrentAction && m_CurrentAction->IsDragging()); // NavigateAction.IsMovingOverEdge()
     //auto& editorStyle = GetStyle();
@@ -1434,30 +1660,42 @@ void ed::EditorContext::End()
         return lhs->m_ZPosition < rhs->m_ZPosition;
     });
 
-# if 1
-    // Every node has few channels assigned. Grow channel list
-    // to hold twice as much of channels and place them in
-    // node drawing order.
+    // Every node has few channels assigned. Put them in node drawing order
+    // by permuting the channel list in place. Channels nothing was drawn into
+    // are moved past the end, so merging only has to visit the ones in use.
+    // Node channel indices are not valid past this point.
     {
-        // Copy group nodes
-        auto liveNodeCount = static_cast<int>(std::count_if(m_Nodes.begin(), m_Nodes.end(), [](Node* node) { return node->m_IsLive; }));
+        // Flush current channel into the splitter, channel 0 stays in place
+        m_DrawList->ChannelsSetCurrent(0);
 
-        // Reserve two additional channels for sorted list of channels
-        auto nodeChannelCount = m_DrawList->_Splitter._Count;
-        ImDrawList_ChannelsGrow(m_DrawList, m_DrawList->_Splitter._Count + c_ChannelsPerNode * liveNodeCount + c_LinkChannelCount);
+        // Link channels keep their indices, they get empty channels in exchange
+        auto channelCount = m_DrawList->_Splitter._Count;
+        ImDrawList_ChannelsGrow(m_DrawList, channelCount + c_LinkChannelCount);
 
-        int targetChannel = nodeChannelCount;
+        m_ChannelOrder.resize(0);
+        for (int i = 0; i < c_NodeStartChannel; ++i)
+        {
+            auto isLinkChannel = i >= c_LinkStartChannel && i < c_LinkStartChannel + c_LinkChannelCount;
+            m_ChannelOrder.push_back(isLinkChannel ? channelCount + (i - c_LinkStartChannel) : i);
+        }
 
-        auto copyNode = [this, &targetChannel](Node* node)
+        // Whatever no live node owns is drawn below all nodes
+        m_ChannelClaimed.assign(channelCount, false);
+        for (auto node : m_Nodes)
+            if (node->m_IsLive && node->m_Channel >= 0)
+                for (int i = 0; i < c_ChannelsPerNode; ++i)
+                    m_ChannelClaimed[node->m_Channel + i] = true;
+        for (int channel = c_NodeStartChannel; channel < channelCount; ++channel)
+            if (!m_ChannelClaimed[channel])
+                m_ChannelOrder.push_back(channel);
+
+        auto copyNode = [this](Node* node)
         {
-            if (!node->m_IsLive)
+            if (!node->m_IsLive || node->m_Channel < 0)
                 return;
 
             for (int i = 0; i < c_ChannelsPerNode; ++i)
-                ImDrawList_SwapChannels(m_DrawList, node->m_Channel + i, targetChannel + i);
-
-            node->m_Channel = targetChannel;
-            targetChannel += c_ChannelsPerNode;
+                m_ChannelOrder.push_back(node->m_Channel + i);
         };
 
         auto groupsItEnd = std::find_if(m_Nodes.begin(), m_Nodes.end(), [](Node* node) { return !IsGroup(node); });
@@ -1466,13 +1704,25 @@ void ed::EditorContext::End()
         std::for_each(m_Nodes.begin(), groupsItEnd, copyNode);
 
         // Copy links
-        for (int i = 0; i < c_LinkChannelCount; ++i, ++targetChannel)
-            ImDrawList_SwapChannels(m_DrawList, c_LinkStartChannel + i, targetChannel);
+        for (int i = 0; i < c_LinkChannelCount; ++i)
+            m_ChannelOrder.push_back(c_LinkStartChannel + i);
 
         // Copy normal nodes
         std::for_each(groupsItEnd, m_Nodes.end(), copyNode);
+
+        // Empty channels go last
+        auto& channels     = m_DrawList->_Splitter._Channels;
+        auto  emptyItBegin = std::stable_partition(m_ChannelOrder.begin() + c_NodeStartChannel, m_ChannelOrder.end(), [&channels](int channel)
+        {
+            return !ImDrawChannel_IsEmpty(channels[channel]);
+        });
+        auto usedCount = static_cast<int>(emptyItBegin - m_ChannelOrder.begin());
+
+        IM_ASSERT(static_cast<int>(m_ChannelOrder.size()) == channelCount + c_LinkChannelCount);
+
+        ImDrawListSplitter_PermuteChannels(&m_DrawList->_Splitter, m_ChannelOrder.data(), static_cast<int>(m_ChannelOrder.size()), m_ChannelScratch);
+        m_DrawList->_Splitter._Count = usedCount;
     }
-# endif
 
     // ImGui::PopClipRect();
 
@@ -1633,6 +1883,19 @@ bool ed::EditorContext::DoLink(LinkId id, PinId startPinId, PinId endPinId, ImU3
 
     link->UpdateEndpoints();
 
+    // Links outside of the view are culled for this frame, so they are neither drawn
+    // nor hit tested but still exist for everything else. A bezier curve never leaves
+    // the bounds of its control points, which makes them a cheap conservative test.
+    const auto& curve = link->GetCurve();
+    auto bounds = ImRect(
+        ImMin(ImMin(curve.P0, curve.P1), ImMin(curve.P2, curve.P3)),
+        ImMax(ImMax(curve.P0, curve.P1), ImMax(curve.P2, curve.P3)));
+    bounds.Expand(thickness + c_LinkSelectThickness + ImMax(startPin->m_ArrowSize, endPin->m_ArrowSize));
+
+    link->m_IsCulled = !GetViewRect().Overlaps(bounds);
+    if (!link->m_IsCulled)
+        m_LinkGrid.Update(link, bounds);
+
     return true;
 }
 
@@ -1691,6 +1954,17 @@ ImVec2 ed::EditorContext::GetNodeSize(NodeId nodeId)
     return node->m_Bounds.GetSize();
 }
 
+bool ed::EditorContext::IsNodeInView(NodeId nodeId)
+{
+    auto node = FindNode(nodeId);
+
+    // Node has to be submitted at least once to know its size and pins
+    if (!node || !node->m_WasSubmitted || node->m_CenterOnScreen || node->m_RestoreState)
+        return true;
+
+    return GetViewRect().Overlaps(node->m_Bounds);
+}
+
 void ed::EditorContext::SetNodeZPosition(NodeId nodeId, float z)
 {
     auto node = FindNode(nodeId);
@@ -1833,13 +2107,31 @@ bool ed::EditorContext::HasSelectionChanged()
     return m_LastSelectedObjects != m_SelectedObjects;
 }
 
+void ed::EditorContext::UpdateSpatialIndex(Node* node)
+{
+    // Pins are hit tested together with their node, so they have to be found with it
+    auto bounds = node->m_Bounds;
+    for (auto pin = node->m_LastPin; pin; pin = pin->m_PreviousPin)
+        bounds.Add(pin->m_Bounds);
+
+    m_NodeGrid.Update(node, bounds);
+}
+
 ed::Node* ed::EditorContext::FindNodeAt(const ImVec2& p)
 {
-    for (auto node : m_Nodes)
-        if (node->TestHit(p))
-            return node;
+    m_GridCandidates.resize(0);
+    m_NodeGrid.Query(ImRect(p, p), m_GridCandidates);
 
-    return nullptr;
+    // First hit in drawing order
+    Node* result = nullptr;
+    for (auto object : m_GridCandidates)
+    {
+        auto node = object->AsNode();
+        if (node->TestHit(p) && (!result || node->m_OrderIndex < result->m_OrderIndex))
+            result = node;
+    }
+
+    return result;
 }
 
 void ed::EditorContext::FindNodesInRect(const ImRect& r, vector<Node*>& result, bool append, bool includeIntersecting)
@@ -1850,9 +2142,18 @@ void ed::EditorContext::FindNodesInRect(const ImRect& r, vector<Node*>& result,
     if (ImRect_IsEmpty(r))
         return;
 
-    for (auto node : m_Nodes)
-        if (node->TestHit(r, includeIntersecting))
-            result.push_back(node);
+    m_GridCandidates.resize(0);
+    m_NodeGrid.Query(r, m_GridCandidates);
+
+    const auto firstResult = result.size();
+    for (auto object : m_GridCandidates)
+        if (object->TestHit(r, includeIntersecting))
+            result.push_back(object->AsNode());
+
+    std::sort(result.begin() + firstResult, result.end(), [](const Node* lhs, const Node* rhs)
+    {
+        return lhs->m_OrderIndex < rhs->m_OrderIndex;
+    });
 }
 
 void ed::EditorContext::FindLinksInRect(const ImRect& r, vector<Link*>& result, bool append)
@@ -1863,9 +2164,18 @@ void ed::EditorContext::FindLinksInRect(const ImRect& r, vector<Link*>& result,
     if (ImRect_IsEmpty(r))
         return;
 
-    for (auto link : m_Links)
-        if (link->TestHit(r))
-            result.push_back(link);
+    m_GridCandidates.resize(0);
+    m_LinkGrid.Query(r, m_GridCandidates);
+
+    const auto firstResult = result.size();
+    for (auto object : m_GridCandidates)
+        if (object->TestHit(r))
+            result.push_back(object->AsLink());
+
+    std::sort(result.begin() + firstResult, result.end(), [](const Link* lhs, const Link* rhs)
+    {
+        return lhs->m_OrderIndex < rhs->m_OrderIndex;
+    });
 }
 
 bool ed::EditorContext::HasAnyLinks(NodeId nodeId) const
@@ -2029,7 +2339,7 @@ ed::Pin* ed::EditorContext::CreatePin(PinId id, PinKind kind)
     IM_ASSERT(nullptr == FindObject(id));
     auto pin = new Pin(this, id, kind);
     m_Pins.push_back({id, pin});
-    std::sort(m_Pins.begin(), m_Pins.end());
+    m_PinIndex[id.Get()] = pin;
     return pin;
 }
 
@@ -2037,8 +2347,9 @@ ed::Node* ed::EditorContext::CreateNode(NodeId id)
 {
     IM_ASSERT(nullptr == FindObject(id));
     auto node = new Node(this, id);
+    node->m_OrderIndex = static_cast<int>(m_Nodes.size());
     m_Nodes.push_back({id, node});
-    //std::sort(Nodes.begin(), Nodes.end());
+    m_NodeIndex[id.Get()] = node;
 
     auto settings = m_Settings.FindNode(id);
     if (!settings)
@@ -2058,67 +2369,59 @@ ed::Link* ed::EditorContext::CreateLink(LinkId id)
 {
     IM_ASSERT(nullptr == FindObject(id));
     auto link = new Link(this, id);
+    link->m_OrderIndex = static_cast<int>(m_Links.size());
     m_Links.push_back({id, link});
-    std::sort(m_Links.begin(), m_Links.end());
+    m_LinkIndex[id.Get()] = link;
 
     return link;
 }
 
-template <typename C, typename Id>
-static inline auto FindItemInLinear(C& container, Id id)
+template <typename T>
+static inline void MergeNewItems(ed::vector<ed::ObjectWrapper<T>>& container, int& sortedCount)
 {
-# if defined(_DEBUG)
-    auto start = container.data();
-    auto end   = container.data() + container.size();
-    for (auto it = start; it < end; ++it)
-        if ((*it).m_ID == id)
-            return it->m_Object;
-# else
-    for (auto item : container)
-        if (item.m_ID == id)
-            return item.m_Object;
-# endif
+    if (sortedCount == static_cast<int>(container.size()))
+        return;
+
+    auto middle = container.begin() + sortedCount;
+    std::sort(middle, container.end());
+    std::inplace_merge(container.begin(), middle, container.end());
+    sortedCount = static_cast<int>(container.size());
+}
 
-   return static_cast<decltype(container[0].m_Object)>(nullptr);
-}
-
-template <typename C, typename Id>
-static inline auto FindItemIn(C& container, Id id)
-{
-//# if defined(_DEBUG)
-//    auto start = container.data();
-//    auto end   = container.data() + container.size();
-//    for (auto it = start; it < end; ++it)
-//        if ((*it)->ID == id)
-//            return *it;
-//# else
-//    for (auto item : container)
-//        if (item->ID == id)
-//            return item;
-//# endif
-    auto key = typename C::value_type{ id, nullptr };
-    auto first = container.cbegin();
-    auto last  = container.cend();
-    auto it    = std::lower_bound(first, last, key);
-    if (it != last && (key.m_ID == it->m_ID))
-        return it->m_Object;
+void ed::EditorContext::SortNewObjects()
+{
+    MergeNewItems(m_Pins,  m_SortedPinCount);
+
+    const auto sortedLinkCount = m_SortedLinkCount;
+    MergeNewItems(m_Links, m_SortedLinkCount);
+    if (sortedLinkCount != m_SortedLinkCount)
+        for (int i = 0; i < static_cast<int>(m_Links.size()); ++i)
+            m_Links[i]->m_OrderIndex = i;
+}
+
+template <typename T, typename Id>
+static inline T* FindItemIn(const std::unordered_map<uintptr_t, T*>& index, Id id)
+{
+    auto it = index.find(id.Get());
+    if (it != index.end())
+        return it->second;
     else
-        return static_cast<decltype(it->m_Object)>(nullptr);
+        return nullptr;
 }
 
 ed::Node* ed::EditorContext::FindNode(NodeId id)
 {
-    return FindItemInLinear(m_Nodes, id);
+    return FindItemIn(m_NodeIndex, id);
 }
 
 ed::Pin* ed::EditorContext::FindPin(PinId id)
 {
-    return FindItemIn(m_Pins, id);
+    return FindItemIn(m_PinIndex, id);
 }
 
 ed::Link* ed::EditorContext::FindLink(LinkId id)
 {
-    return FindItemIn(m_Links, id);
+    return FindItemIn(m_LinkIndex, id);
 }
 
 ed::Object* ed::EditorContext::FindObject(ObjectId id)
@@ -2220,11 +2523,19 @@ void ed::EditorContext::MakeDirty(SaveReasonFlags reason, Node* node)
 
 ed::Link* ed::EditorContext::FindLinkAt(const ImVec2& p)
 {
-    for (auto& link : m_Links)
-        if (link->TestHit(p, c_LinkSelectThickness))
-            return link;
+    m_GridCandidates.resize(0);
+    m_LinkGrid.Query(ImRect(p, p), m_GridCandidates);
 
-    return nullptr;
+    // Same link as a scan over m_Links would find, no matter which cell it is listed in first
+    Link* result = nullptr;
+    for (auto object : m_GridCandidates)
+    {
+        auto link = object->AsLink();
+        if ((!result || link->m_OrderIndex < result->m_OrderIndex) && link->TestHit(p, c_LinkSelectThickness))
+            result = link;
+    }
+
+    return result;
 }
 
 ImU32 ed::EditorContext::GetColor(StyleColor colorIndex) const
@@ -2423,10 +2734,25 @@ ed::Control ed::EditorContext::BuildControl(bool allowOffscreen)
             activeObject = object;
     };
 
+    // Only nodes under the mouse can be hovered or clicked, so interactive areas are
+    // only emitted for those. The active node keeps its areas wherever the mouse is,
+    // ImGui would lose track of its active item otherwise (e.g. the pin a new link
+    // is dragged from).
+    m_GridCandidates.resize(0);
+    m_NodeGrid.Query(ImRect(mousePos, mousePos), m_GridCandidates);
+    if (m_LastActiveNode && std::find(m_GridCandidates.begin(), m_GridCandidates.end(), m_LastActiveNode) == m_GridCandidates.end())
+        m_GridCandidates.push_back(m_LastActiveNode);
+
+    // Front to back
+    std::sort(m_GridCandidates.begin(), m_GridCandidates.end(), [](Object* lhs, Object* rhs)
+    {
+        return lhs->AsNode()->m_OrderIndex > rhs->AsNode()->m_OrderIndex;
+    });
+
     // Process live nodes and pins.
-    for (auto nodeIt = m_Nodes.rbegin(), nodeItEnd = m_Nodes.rend(); nodeIt != nodeItEnd; ++nodeIt)
+    for (auto object : m_GridCandidates)
     {
-        auto node = *nodeIt;
+        auto node = object->AsNode();
 
         if (!node->m_IsLive) continue;
 
@@ -2473,6 +2799,11 @@ ed::Control ed::EditorContext::BuildControl(bool allowOffscreen)
             checkInteractionsInArea(node->m_ID, node->m_Bounds, node);
     }
 
+    // Nodes and pins are the only objects that can be active at this point
+    m_LastActiveNode = nullptr;
+    if (activeObject)
+        m_LastActiveNode = activeObject->AsPin() ? activeObject->AsPin()->m_Node : activeObject->AsNode();
+
     // Links are not regular widgets and must be done manually since
     // ImGui does not support interactive elements with custom hit maps.
     //
@@ -2740,15 +3071,16 @@ bool ed::NodeSettings::Parse(const json::value& data, NodeSettings& result)
 //------------------------------------------------------------------------------
 ed::NodeSettings* ed::Settings::AddNode(NodeId id)
 {
+    m_NodeIndex[id.Get()] = static_cast<int>(m_Nodes.size());
     m_Nodes.push_back(NodeSettings(id));
     return &m_Nodes.back();
 }
 
 ed::NodeSettings* ed::Settings::FindNode(NodeId id)
 {
-    for (auto& settings : m_Nodes)
-        if (settings.m_ID == id)
-            return &settings;
+    auto it = m_NodeIndex.find(id.Get());
+    if (it != m_NodeIndex.end())
+        return &m_Nodes[it->second];
 
     return nullptr;
 }
@@ -5305,9 +5637,42 @@ void ed::NodeBuilder::End()
     else
         m_CurrentNode->m_Type        = NodeType::Node;
 
+    m_CurrentNode->m_PinOrigin    = m_CurrentNode->m_Bounds.Min;
+    m_CurrentNode->m_WasSubmitted = true;
+
+    Editor->UpdateSpatialIndex(m_CurrentNode);
+
     m_CurrentNode = nullptr;
 }
 
+void ed::NodeBuilder::Skip(NodeId nodeId)
+{
+    IM_ASSERT(nullptr == m_CurrentNode);
+
+    auto node = Editor->GetNode(nodeId);
+
+    Editor->UpdateNodeState(node);
+
+    // Pins keep their bounds from the last time the node was submitted. Move them
+    // along if the node was moved since then (dragged or repositioned by the user).
+    auto offset = node->m_Bounds.Min - node->m_PinOrigin;
+    for (auto pin = node->m_LastPin; pin; pin = pin->m_PreviousPin)
+    {
+        if (offset.x != 0.0f || offset.y != 0.0f)
+        {
+            pin->m_Bounds.Translate(offset);
+            pin->m_Pivot.Translate(offset);
+        }
+        pin->m_IsLive = true;
+    }
+
+    node->m_PinOrigin = node->m_Bounds.Min;
+    node->m_IsLive    = true;
+    node->m_Channel   = -1;
+
+    Editor->UpdateSpatialIndex(node);
+}
+
 void ed::NodeBuilder::BeginPin(PinId pinId, PinKind kind)
 {
     IM_ASSERT(nullptr != m_CurrentNode);
@@ -5452,7 +5817,7 @@ ImDrawList* ed::NodeBuilder::GetUserBackgroundDrawList() const
 
 ImDrawList* ed::NodeBuilder::GetUserBackgroundDrawList(Node* node) const
 {
-    if (node && node->m_IsLive)
+    if (node && node->m_IsLive && node->m_Channel >= 0)
     {
         auto drawList = Editor->GetDrawList();
         drawList->ChannelsSetCurrent(node->m_Channel + c_NodeUserBackgroundChannel);
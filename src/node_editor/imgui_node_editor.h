@@ -308,6 +308,8 @@ IMGUI_NODE_EDITOR_API void PinPivotAlignment(const ImVec2& alignment);
 IMGUI_NODE_EDITOR_API void EndPin();
 IMGUI_NODE_EDITOR_API void Group(const ImVec2& size);
 IMGUI_NODE_EDITOR_API void EndNode();
+IMGUI_NODE_EDITOR_API bool IsNodeInView(NodeId nodeId); // Returns false if the last known bounds of the node are outside of the visible canvas
+IMGUI_NODE_EDITOR_API void SkipNode(NodeId nodeId); // Keeps a node and its pins alive for this frame without submitting its content, use instead of BeginNode()/EndNode()
 
 IMGUI_NODE_EDITOR_API bool BeginGroupHint(NodeId nodeId);
 IMGUI_NODE_EDITOR_API ImVec2 GetGroupMin();
@@ -356,6 +358,7 @@ IMGUI_NODE_EDITOR_API void Resume();
 IMGUI_NODE_EDITOR_API bool IsSuspended();
 
 IMGUI_NODE_EDITOR_API bool IsActive();
+IMGUI_NODE_EDITOR_API bool IsAnimating(EditorContext* ctx = nullptr); // Returns true while navigation, flow or other animations still need frames
 
 IMGUI_NODE_EDITOR_API bool HasSelectionChanged();
 IMGUI_NODE_EDITOR_API int  GetSelectedObjectCount();
@@ -379,6 +382,7 @@ IMGUI_NODE_EDITOR_API int BreakLinks(PinId pinId); // Break all links connected
 
 IMGUI_NODE_EDITOR_API void NavigateToContent(float duration = -1);
 IMGUI_NODE_EDITOR_API void NavigateToSelection(bool zoomIn = false, float duration = -1);
+IMGUI_NODE_EDITOR_API void NavigateToRect(const ImVec2& min, const ImVec2& max, float duration = -1); // Zooms so that exactly this canvas area is visible
 
 IMGUI_NODE_EDITOR_API bool ShowNodeContextMenu(NodeId* nodeId);
 IMGUI_NODE_EDITOR_API bool ShowPinContextMenu(PinId* pinId);
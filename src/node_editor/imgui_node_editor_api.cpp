@@ -193,6 +193,16 @@ void ax::NodeEditor::EndNode()
     s_Editor->GetNodeBuilder().End();
 }
 
+bool ax::NodeEditor::IsNodeInView(NodeId nodeId)
+{
+    return s_Editor->IsNodeInView(nodeId);
+}
+
+void ax::NodeEditor::SkipNode(NodeId nodeId)
+{
+    s_Editor->GetNodeBuilder().Skip(nodeId);
+}
+
 bool ax::NodeEditor::BeginGroupHint(NodeId nodeId)
 {
     return s_Editor->GetHintBuilder().Begin(nodeId);
@@ -449,6 +459,14 @@ bool ax::NodeEditor::IsActive()
     return s_Editor->IsFocused();
 }
 
+bool ax::NodeEditor::IsAnimating(EditorContext* ctx)
+{
+    if (ctx == nullptr)
+        ctx = GetCurrentEditor();
+
+    return ctx && reinterpret_cast<ax::NodeEditor::Detail::EditorContext*>(ctx)->IsAnimating();
+}
+
 bool ax::NodeEditor::HasSelectionChanged()
 {
     return s_Editor->HasSelectionChanged();
@@ -576,6 +594,11 @@ void ax::NodeEditor::NavigateToSelection(bool zoomIn, float duration)
     s_Editor->NavigateTo(s_Editor->GetSelectionBounds(), zoomIn, duration);
 }
 
+void ax::NodeEditor::NavigateToRect(const ImVec2& min, const ImVec2& max, float duration)
+{
+    s_Editor->NavigateToRect(ImRect(min, max), duration);
+}
+
 bool ax::NodeEditor::ShowNodeContextMenu(NodeId* nodeId)
 {
     return s_Editor->GetContextMenu().ShowNodeContextMenu(nodeId);
@@ -32,6 +32,7 @@
 
 # include <vector>
 # include <string>
+# include <unordered_map>
 
 
 //------------------------------------------------------------------------------
@@ -201,6 +202,94 @@ struct ObjectWrapper
     }
 };
 
+struct Object;
+
+// Uniform grid over object bounds, so that hit tests only have to look at the
+// objects close to the point or rectangle in question. Objects are only moved
+// between cells when their bounds cross a cell border.
+struct SpatialGrid
+{
+    struct Range
+    {
+        int MinX = 0;
+        int MinY = 0;
+        int MaxX = -1;
+        int MaxY = -1;
+
+        bool IsEmpty() const { return MaxX < MinX || MaxY < MinY; }
+        long long CellCount() const { return IsEmpty() ? 0 : (long long)(MaxX - MinX + 1) * (MaxY - MinY + 1); }
+
+        bool operator==(const Range& rhs) const { return MinX == rhs.MinX && MinY == rhs.MinY && MaxX == rhs.MaxX && MaxY == rhs.MaxY; }
+        bool operator!=(const Range& rhs) const { return !(*this == rhs); }
+    };
+
+    void Update(Object* object, const ImRect& bounds);
+    void Remove(Object* object);
+
+    // Appends every object whose cells overlap the rectangle. Results are only
+    // candidates, they still have to be hit tested.
+    void Query(const ImRect& rect, vector<Object*>& result);
+
+private:
+    static Range CalcRange(const ImRect& bounds);
+    static ImU64 CellKey(int x, int y) { return (static_cast<ImU64>(static_cast<ImU32>(x)) << 32) | static_cast<ImU32>(y); }
+
+    std::unordered_map<ImU64, vector<Object*>> m_Cells;
+    vector<Object*> m_LargeObjects; // Objects covering too many cells to be worth storing in each
+    unsigned        m_QueryMark = 0;
+};
+
+// Slab allocator for editor objects. Freed slots go onto a free list and are
+// handed out again by the next allocation, by any editor. Slabs are never
+// returned to the system, so switching documents doesn't hit the heap again.
+// Not thread safe, like the rest of the editor.
+template <typename T>
+struct ObjectPool
+{
+    static void* Allocate(size_t size)
+    {
+        IM_ASSERT(size == sizeof(T));
+        IM_UNUSED(size);
+
+        if (!s_FreeList)
+            AddSlab();
+
+        auto slot  = s_FreeList;
+        s_FreeList = slot->m_Next;
+        return slot;
+    }
+
+    static void Free(void* object)
+    {
+        if (!object)
+            return;
+
+        auto slot    = static_cast<Slot*>(object);
+        slot->m_Next = s_FreeList;
+        s_FreeList   = slot;
+    }
+
+private:
+    static const int c_SlabSize = 256;
+
+    union Slot
+    {
+        Slot* m_Next;
+        alignas(T) unsigned char m_Storage[sizeof(T)];
+    };
+
+    static void AddSlab()
+    {
+        auto slab = static_cast<Slot*>(::operator new(sizeof(Slot) * c_SlabSize));
+        for (int i = 0; i < c_SlabSize - 1; ++i)
+            slab[i].m_Next = &slab[i + 1];
+        slab[c_SlabSize - 1].m_Next = s_FreeList;
+        s_FreeList = slab;
+    }
+
+    static inline Slot* s_FreeList = nullptr;
+};
+
 struct Object
 {
     enum DrawFlags
@@ -222,11 +311,16 @@ struct Object
     bool    m_IsSelected;
     bool    m_DeleteOnNewFrame;
 
+    SpatialGrid::Range m_GridRange;
+    unsigned           m_GridQueryMark;
+
     Object(EditorContext* editor)
         : Editor(editor)
         , m_IsLive(true)
         , m_IsSelected(false)
         , m_DeleteOnNewFrame(false)
+        , m_GridRange()
+        , m_GridQueryMark(0)
     {
     }
 
@@ -289,6 +383,9 @@ struct Pin final: Object
 {
     using IdType = PinId;
 
+    static void* operator new(size_t size) { return ObjectPool<Pin>::Allocate(size); }
+    static void operator delete(void* object) { ObjectPool<Pin>::Free(object); }
+
     PinId   m_ID;
     PinKind m_Kind;
     Node*   m_Node;
@@ -381,12 +478,18 @@ struct Node final: Object
 {
     using IdType = NodeId;
 
+    static void* operator new(size_t size) { return ObjectPool<Node>::Allocate(size); }
+    static void operator delete(void* object) { ObjectPool<Node>::Free(object); }
+
     NodeId   m_ID;
     NodeType m_Type;
     ImRect   m_Bounds;
     float    m_ZPosition;
+    int      m_OrderIndex;
     int      m_Channel;
     Pin*     m_LastPin;
+    ImVec2   m_PinOrigin;
+    bool     m_WasSubmitted;
     ImVec2   m_DragStart;
 
     ImU32    m_Color;
@@ -411,8 +514,11 @@ struct Node final: Object
         , m_Type(NodeType::Node)
         , m_Bounds()
         , m_ZPosition(0.0f)
+        , m_OrderIndex(0)
         , m_Channel(0)
         , m_LastPin(nullptr)
+        , m_PinOrigin()
+        , m_WasSubmitted(false)
         , m_DragStart()
         , m_Color(IM_COL32_WHITE)
         , m_BorderColor(IM_COL32_BLACK)
@@ -453,6 +559,9 @@ struct Link final: Object
 {
     using IdType = LinkId;
 
+    static void* operator new(size_t size) { return ObjectPool<Link>::Allocate(size); }
+    static void operator delete(void* object) { ObjectPool<Link>::Free(object); }
+
     LinkId m_ID;
     Pin*   m_StartPin;
     Pin*   m_EndPin;
@@ -461,6 +570,17 @@ struct Link final: Object
     float  m_Thickness;
     ImVec2 m_Start;
     ImVec2 m_End;
+    int    m_OrderIndex;
+    bool   m_IsCulled; // Outside of the view this frame, skipped by drawing and hit testing
+
+    // Derived from the endpoints, invalidated by UpdateEndpoints() only when the curve changes
+    ImCubicBezierPoints    m_Curve;
+    mutable ImRect         m_Bounds;
+    mutable float          m_BoundsStartArrowSize;
+    mutable float          m_BoundsEndArrowSize;
+    mutable bool           m_IsBoundsValid;
+    mutable vector<ImVec2> m_Polyline;
+    mutable float          m_PolylineTessellationTol; // < 0 if m_Polyline is out of date
 
     Link(EditorContext* editor, LinkId id)
         : Object(editor)
@@ -469,6 +589,13 @@ struct Link final: Object
         , m_EndPin(nullptr)
         , m_Color(IM_COL32_WHITE)
         , m_Thickness(1.0f)
+        , m_OrderIndex(0)
+        , m_IsCulled(false)
+        , m_Curve()
+        , m_BoundsStartArrowSize(0.0f)
+        , m_BoundsEndArrowSize(0.0f)
+        , m_IsBoundsValid(false)
+        , m_PolylineTessellationTol(-1.0f)
     {
     }
 
@@ -481,7 +608,8 @@ struct Link final: Object
 
     void UpdateEndpoints();
 
-    ImCubicBezierPoints GetCurve() const;
+    const ImCubicBezierPoints& GetCurve() const;
+    const vector<ImVec2>& GetPolyline(ImDrawList* drawList) const;
 
     virtual bool TestHit(const ImVec2& point, float extraThickness = 0.0f) const override final;
     virtual bool TestHit(const ImRect& rect, bool allowIntersect = true) const override final;
@@ -489,6 +617,9 @@ struct Link final: Object
     virtual ImRect GetBounds() const override final;
 
     virtual Link* AsLink() override final { return this; }
+
+private:
+    ImCubicBezierPoints CalculateCurve() const;
 };
 
 struct NodeSettings
@@ -530,6 +661,7 @@ struct Settings
     SaveReasonFlags      m_DirtyReason;
 
     vector<NodeSettings> m_Nodes;
+    std::unordered_map<uintptr_t, int> m_NodeIndex; // node id -> index in m_Nodes
     vector<ObjectId>     m_Selection;
     ImVec2               m_ViewScroll;
     float                m_ViewZoom;
@@ -1195,6 +1327,7 @@ struct NodeBuilder
 
     void Begin(NodeId nodeId);
     void End();
+    void Skip(NodeId nodeId);
 
     void BeginPin(PinId pinId, PinKind kind);
     void EndPin();
@@ -1320,6 +1453,7 @@ struct EditorContext
     void SetGroupSize(NodeId nodeId, const ImVec2& size);
     ImVec2 GetNodePosition(NodeId nodeId);
     ImVec2 GetNodeSize(NodeId nodeId);
+    bool IsNodeInView(NodeId nodeId);
 
     void SetNodeZPosition(NodeId nodeId, float z);
     float GetNodeZPosition(NodeId nodeId);
@@ -1341,6 +1475,9 @@ struct EditorContext
     bool HasSelectionChanged();
     uint64_t GetSelectionId() const { return m_SelectionId; }
 
+    void UpdateSpatialIndex(Node* node);
+    void SortNewObjects();
+
     Node* FindNodeAt(const ImVec2& p);
     void FindNodesInRect(const ImRect& r, vector<Node*>& result, bool append = false, bool includeIntersecting = true);
     void FindLinksInRect(const ImRect& r, vector<Link*>& result, bool append = false);
@@ -1365,6 +1502,7 @@ struct EditorContext
     bool IsSuspended();
 
     bool IsFocused();
+    bool IsAnimating() const { return !m_LiveAnimations.empty(); }
     bool IsHovered() const;
     bool IsHoveredWithoutOverlapp() const;
     bool CanAcceptUserInput() const;
@@ -1435,6 +1573,11 @@ struct EditorContext
         m_NavigateAction.NavigateTo(bounds, zoomMode, duration);
     }
 
+    void NavigateToRect(const ImRect& rect, float duration = -1)
+    {
+        m_NavigateAction.NavigateTo(rect, NavigateAction::ZoomMode::Exact, duration);
+    }
+
     void RegisterAnimation(Animation* animation);
     void UnregisterAnimation(Animation* animation);
 
@@ -1497,12 +1640,27 @@ private:
     vector<ObjectWrapper<Pin>>  m_Pins;
     vector<ObjectWrapper<Link>> m_Links;
 
+    // Id lookup, FindNode() & co. are called for every submitted item
+    std::unordered_map<uintptr_t, Node*> m_NodeIndex;
+    std::unordered_map<uintptr_t, Pin*>  m_PinIndex;
+    std::unordered_map<uintptr_t, Link*> m_LinkIndex;
+
+    // Pins and links are kept sorted by id, new ones are appended past these
+    // counts and merged in once per frame by SortNewObjects()
+    int                 m_SortedPinCount;
+    int                 m_SortedLinkCount;
+
+    SpatialGrid         m_NodeGrid;
+    SpatialGrid         m_LinkGrid;
+    vector<Object*>     m_GridCandidates;
+
     vector<Object*>     m_SelectedObjects;
 
     vector<Object*>     m_LastSelectedObjects;
     uint64_t            m_SelectionId;
 
     Link*               m_LastActiveLink;
+    Node*               m_LastActiveNode;
 
     vector<Animation*>  m_LiveAnimations;
     vector<Animation*>  m_LastLiveAnimations;
@@ -1541,6 +1699,11 @@ private:
     ImDrawList*         m_DrawList;
     int                 m_ExternalChannel;
     ImDrawListSplitter  m_Splitter;
+
+    // Scratch space for putting channels into drawing order in End()
+    vector<int>             m_ChannelOrder;
+    vector<bool>            m_ChannelClaimed;
+    ImVector<ImDrawChannel> m_ChannelScratch;
 };
 
 
@@ -0,0 +1,197 @@
+#include "profiler_window.hpp"
+
+#ifdef AINBY_PROFILER
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+
+// Height of the frame time graph
+#define FRAME_GRAPH_HEIGHT 60.0f
+// Height of the scope table, it scrolls past that
+#define SUMMARY_HEIGHT 160.0f
+// Scopes narrower than this (in pixels) get no label
+#define MIN_LABEL_WIDTH 24.0f
+
+static double ToMilliseconds(u64 ns) {
+    return ns / 1e6;
+}
+
+// Same name, same color, from frame to frame
+static ImU32 GetScopeColor(std::string_view name) {
+    float hue = (std::hash<std::string_view>()(name) % 360) / 360.0f;
+    return ImColor::HSV(hue, 0.45f, 0.65f);
+}
+
+void ProfilerWindow::Draw(bool *open) {
+    AINBY_PROFILE_SCOPE("ProfilerWindow::Draw");
+    if (!ImGui::Begin("Profiler", open)) {
+        ImGui::End();
+        return;
+    }
+
+    ImGui::Checkbox("Pause", &paused);
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(200);
+    ImGui::SliderFloat("Zoom", &zoom, 1.0f, 200.0f, "%.1fx", ImGuiSliderFlags_Logarithmic);
+
+    if (!paused) {
+        frames = Profiler::GetFrames();
+    }
+    if (frames.empty()) {
+        ImGui::TextUnformatted("No frames recorded yet");
+        ImGui::End();
+        return;
+    }
+    selectedFrame = std::clamp(selectedFrame, 0, (int) frames.size() - 1);
+    const Profiler::Frame &frame = frames[frames.size() - 1 - selectedFrame];
+
+    // While running only the selected frame is copied. Pausing copies everything
+    // still in the buffers once, so that older frames can be looked at, too.
+    if (!paused) {
+        Profiler::Collect(frame.start, threads);
+    } else if (!wasPaused) {
+        Profiler::Collect(frames.front().start, threads);
+    }
+    wasPaused = paused;
+
+    DrawFrameGraph();
+    ImGui::Text("Frame %d frames ago: %.3f ms", selectedFrame, ToMilliseconds(frame.end - frame.start));
+    if (ImGui::CollapsingHeader("Scopes", ImGuiTreeNodeFlags_DefaultOpen)) {
+        DrawSummary(frame);
+    }
+    DrawTimeline(frame);
+
+    ImGui::End();
+}
+
+void ProfilerWindow::DrawFrameGraph() {
+    frameTimes.clear();
+    float maxTime = 0;
+    for (const Profiler::Frame &frame : frames) {
+        frameTimes.push_back(ToMilliseconds(frame.end - frame.start));
+        maxTime = std::max(maxTime, frameTimes.back());
+    }
+    ImGui::PlotHistogram("##FrameTimes", frameTimes.data(), frameTimes.size(), 0, nullptr, 0.0f, maxTime,
+        ImVec2(-FLT_MIN, FRAME_GRAPH_HEIGHT));
+
+    // Clicking a bar selects its frame
+    if (ImGui::IsItemHovered() && ImGui::IsMouseClicked(ImGuiMouseButton_Left)) {
+        ImVec2 min = ImGui::GetItemRectMin();
+        ImVec2 max = ImGui::GetItemRectMax();
+        float t = (ImGui::GetMousePos().x - min.x) / (max.x - min.x);
+        int idx = std::clamp((int) (t * frameTimes.size()), 0, (int) frameTimes.size() - 1);
+        selectedFrame = frameTimes.size() - 1 - idx;
+    }
+}
+
+void ProfilerWindow::DrawSummary(const Profiler::Frame &frame) {
+    std::unordered_map<std::string_view, size_t> summaryIdx;
+    summary.clear();
+    for (const Profiler::Thread &thread : threads) {
+        for (const Profiler::Event &event : thread.events) {
+            if (event.end < frame.start || event.end > frame.end) {
+                continue;
+            }
+            auto [it, inserted] = summaryIdx.try_emplace(std::string_view(event.name), summary.size());
+            if (inserted) {
+                summary.push_back({ event.name, 0, 0, 0 });
+            }
+            ScopeSummary &scope = summary[it->second];
+            u64 duration = event.end - event.start;
+            scope.count++;
+            scope.total += duration;
+            scope.max = std::max(scope.max, duration);
+        }
+    }
+    std::sort(summary.begin(), summary.end(), [](const ScopeSummary &a, const ScopeSummary &b) {
+        return a.total > b.total;
+    });
+
+    ImGuiTableFlags flags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY;
+    if (ImGui::BeginTable("##Scopes", 4, flags, ImVec2(0, SUMMARY_HEIGHT))) {
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Scope");
+        ImGui::TableSetupColumn("Count");
+        ImGui::TableSetupColumn("Total (ms)");
+        ImGui::TableSetupColumn("Max (ms)");
+        ImGui::TableHeadersRow();
+        for (const ScopeSummary &scope : summary) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::TextUnformatted(scope.name.data(), scope.name.data() + scope.name.size());
+            ImGui::TableNextColumn();
+            ImGui::Text("%u", scope.count);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", ToMilliseconds(scope.total));
+            ImGui::TableNextColumn();
+            ImGui::Text("%.3f", ToMilliseconds(scope.max));
+        }
+        ImGui::EndTable();
+    }
+}
+
+void ProfilerWindow::DrawTimeline(const Profiler::Frame &frame) {
+    if (!ImGui::BeginChild("##Timeline", ImVec2(0, 0), true, ImGuiWindowFlags_HorizontalScrollbar)) {
+        ImGui::EndChild();
+        return;
+    }
+
+    float width = ImGui::GetContentRegionAvail().x * zoom;
+    double scale = width / (double) std::max<u64>(frame.end - frame.start, 1);
+    float rowHeight = ImGui::GetTextLineHeightWithSpacing();
+    ImDrawList *drawList = ImGui::GetWindowDrawList();
+    ImVec2 clipMin = drawList->GetClipRectMin();
+    ImVec2 clipMax = drawList->GetClipRectMax();
+    ImVec2 mouse = ImGui::GetMousePos();
+
+    for (const Profiler::Thread &thread : threads) {
+        // Threads that did nothing during the frame get no track
+        u32 maxDepth = 0;
+        bool active = false;
+        for (const Profiler::Event &event : thread.events) {
+            if (event.end >= frame.start && event.start <= frame.end) {
+                maxDepth = std::max(maxDepth, event.depth);
+                active = true;
+            }
+        }
+        if (!active) {
+            continue;
+        }
+
+        ImGui::TextUnformatted(thread.name.c_str());
+        ImVec2 origin = ImGui::GetCursorScreenPos();
+        ImGui::Dummy(ImVec2(width, (maxDepth + 1) * rowHeight));
+        if (origin.y > clipMax.y || origin.y + (maxDepth + 1) * rowHeight < clipMin.y) {
+            continue;
+        }
+
+        for (const Profiler::Event &event : thread.events) {
+            if (event.end < frame.start || event.start > frame.end) {
+                continue;
+            }
+            float x0 = origin.x + (std::max(event.start, frame.start) - frame.start) * scale;
+            float x1 = origin.x + (std::min(event.end, frame.end) - frame.start) * scale;
+            x1 = std::max(x1, x0 + 1.0f);
+            if (x1 < clipMin.x || x0 > clipMax.x) {
+                continue;
+            }
+            ImVec2 min(x0, origin.y + event.depth * rowHeight);
+            ImVec2 max(x1, min.y + rowHeight - 1.0f);
+            drawList->AddRectFilled(min, max, GetScopeColor(event.name));
+            if (x1 - x0 >= MIN_LABEL_WIDTH) {
+                drawList->PushClipRect(min, max, true);
+                drawList->AddText(ImVec2(min.x + 2.0f, min.y), IM_COL32_WHITE, event.name);
+                drawList->PopClipRect();
+            }
+            if (ImGui::IsWindowHovered() && mouse.x >= min.x && mouse.x < max.x && mouse.y >= min.y && mouse.y < max.y) {
+                ImGui::SetTooltip("%s\n%.3f ms", event.name, ToMilliseconds(event.end - event.start));
+            }
+        }
+    }
+    ImGui::EndChild();
+}
+
+#endif
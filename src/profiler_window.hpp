@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+
+#include "util/profiler.hpp"
+
+#ifdef AINBY_PROFILER
+
+// Shows where the recent frames spent their time: a graph of the frame times,
+// the scopes of the selected frame and a timeline of it with one track per thread
+class ProfilerWindow {
+public:
+    void Draw(bool *open);
+
+private:
+    struct ScopeSummary {
+        std::string_view name;
+        u32 count;
+        u64 total;
+        u64 max;
+    };
+
+    void DrawFrameGraph();
+    void DrawSummary(const Profiler::Frame &frame);
+    void DrawTimeline(const Profiler::Frame &frame);
+
+    bool paused = false;
+    bool wasPaused = false;
+    float zoom = 1.0f;
+    // Frame shown below the graph, counted back from the newest one
+    int selectedFrame = 0;
+
+    std::vector<Profiler::Frame> frames;
+    std::vector<float> frameTimes;
+    std::vector<Profiler::Thread> threads;
+    std::vector<ScopeSummary> summary;
+};
+
+#endif
@@ -0,0 +1,112 @@
+#include "archive_cache.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <vector>
+
+#include "file_formats/zstd.hpp"
+#include "util/hash.hpp"
+#include "util/profiler.hpp"
+
+namespace fs = std::filesystem;
+
+ArchiveCache::ArchiveCache(const fs::path &directory, size_t maxSize) : directory(directory), maxSize(maxSize) {
+    fs::create_directories(directory);
+}
+
+MappedFile ArchiveCache::Open(const u8 *compressed, size_t compressedSize) {
+    AINBY_PROFILE_SCOPE("ArchiveCache::Open");
+    fs::path entryPath = directory / (HashToString(HashData(compressed, compressedSize)) + ".sarc");
+
+    std::error_code ec;
+    if (fs::exists(entryPath, ec)) {
+        // The modification time doubles as the last access time for eviction
+        fs::last_write_time(entryPath, fs::file_time_type::clock::now(), ec);
+        return MappedFile(entryPath);
+    }
+
+    ZSTD zstdFile;
+    zstdFile.Read(compressed, compressedSize);
+
+    size_t decompressedSize;
+    const u8 *decompressed = zstdFile.GetData(decompressedSize);
+
+    // Write to a temporary file first so that an interrupted write never leaves a broken entry behind
+    fs::path tempPath = entryPath;
+    tempPath += ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary);
+        file.write((const char *) decompressed, decompressedSize);
+        if (!file) {
+            throw std::runtime_error("Could not write cache entry " + tempPath.string());
+        }
+    }
+    fs::rename(tempPath, entryPath);
+
+    Evict(entryPath);
+    return MappedFile(entryPath);
+}
+
+MappedFile ArchiveCache::Open(const fs::path &szPath) {
+    MappedFile compressed(szPath);
+    size_t compressedSize;
+    const u8 *compressedData = compressed.GetData(compressedSize);
+    return Open(compressedData, compressedSize);
+}
+
+void ArchiveCache::Clear() {
+    std::error_code ec;
+    for (const fs::directory_entry &entry : fs::directory_iterator(directory, ec)) {
+        if (entry.path().extension() == ".sarc") {
+            fs::remove(entry.path(), ec);
+        }
+    }
+}
+
+fs::path ArchiveCache::DefaultDirectory() {
+    if (const char *dir = std::getenv("AINBY_CACHE_DIR")) {
+        return dir;
+    }
+    return fs::temp_directory_path() / "ainby_cache";
+}
+
+void ArchiveCache::Evict(const fs::path &keep) {
+    struct Entry {
+        fs::path path;
+        fs::file_time_type lastUse;
+        size_t size;
+    };
+    std::vector<Entry> entries;
+    size_t totalSize = 0;
+
+    std::error_code ec;
+    for (const fs::directory_entry &entry : fs::directory_iterator(directory, ec)) {
+        if (entry.path().extension() != ".sarc") {
+            continue;
+        }
+        size_t size = entry.file_size(ec);
+        entries.push_back({ entry.path(), entry.last_write_time(ec), size });
+        totalSize += size;
+    }
+    if (totalSize <= maxSize) {
+        return;
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+        return a.lastUse < b.lastUse;
+    });
+    for (const Entry &entry : entries) {
+        if (totalSize <= maxSize) {
+            break;
+        }
+        if (entry.path == keep) {
+            continue;
+        }
+        // Removing a file that is still mapped is fine, the mapping stays valid
+        // (on Windows the removal fails instead and the entry is retried next time)
+        if (fs::remove(entry.path, ec)) {
+            totalSize -= entry.size;
+        }
+    }
+}
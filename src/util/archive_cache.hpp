@@ -0,0 +1,30 @@
+#pragma once
+
+#include <filesystem>
+
+#include "types.h"
+#include "util/mapped_file.hpp"
+
+// On-disk cache of decompressed SZ files. Entries are keyed by a hash of the
+// compressed file, so renamed or moved files still hit the cache, and modified
+// ones never return stale data. Least recently used entries are evicted once
+// the cache grows past maxSize bytes.
+class ArchiveCache {
+public:
+    ArchiveCache(const std::filesystem::path &directory, size_t maxSize);
+
+    // Returns the decompressed contents of the given compressed data,
+    // decompressing and storing them first if they are not cached yet
+    MappedFile Open(const u8 *compressed, size_t compressedSize);
+    MappedFile Open(const std::filesystem::path &szPath);
+
+    void Clear();
+
+    static std::filesystem::path DefaultDirectory();
+
+private:
+    void Evict(const std::filesystem::path &keep);
+
+    std::filesystem::path directory;
+    size_t maxSize;
+};
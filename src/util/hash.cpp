@@ -0,0 +1,16 @@
+#include "hash.hpp"
+
+#include <cstdio>
+
+#define XXH_INLINE_ALL
+#include <common/xxhash.h>
+
+u64 HashData(const u8 *data, size_t size, u64 seed) {
+    return XXH64(data, size, seed);
+}
+
+std::string HashToString(u64 hash) {
+    char buf[17];
+    snprintf(buf, sizeof(buf), "%016llx", (unsigned long long) hash);
+    return buf;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "types.h"
+
+// Fast non-cryptographic hash (XXH64, shipped with zstd)
+u64 HashData(const u8 *data, size_t size, u64 seed = 0);
+std::string HashToString(u64 hash);
@@ -0,0 +1,128 @@
+#include "mapped_file.hpp"
+
+#include <stdexcept>
+#include <utility>
+
+#ifdef WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "util/profiler.hpp"
+
+MappedFile::MappedFile(const std::filesystem::path &path) {
+    AINBY_PROFILE_SCOPE("MappedFile");
+#ifdef WIN32
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Could not open file " + path.string());
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+        CloseHandle(file);
+        throw std::runtime_error("Could not get size of file " + path.string());
+    }
+    size = (size_t) fileSize.QuadPart;
+    fileHandle = file;
+    isOpen = true;
+    if (size == 0) {
+        return;
+    }
+
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        Close();
+        throw std::runtime_error("Could not map file " + path.string());
+    }
+    mappingHandle = mapping;
+    data = (const u8 *) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (data == nullptr) {
+        Close();
+        throw std::runtime_error("Could not map file " + path.string());
+    }
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open file " + path.string());
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        throw std::runtime_error("Could not get size of file " + path.string());
+    }
+    size = st.st_size;
+    if (size == 0) {
+        close(fd);
+        isOpen = true;
+        return;
+    }
+
+    void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps its own reference to the file
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        size = 0;
+        throw std::runtime_error("Could not map file " + path.string());
+    }
+    data = (const u8 *) mapping;
+    isOpen = true;
+#endif
+}
+
+MappedFile::~MappedFile() {
+    Close();
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept {
+    *this = std::move(other);
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+    if (this != &other) {
+        Close();
+        data = std::exchange(other.data, nullptr);
+        size = std::exchange(other.size, 0);
+        isOpen = std::exchange(other.isOpen, false);
+#ifdef WIN32
+        fileHandle = std::exchange(other.fileHandle, nullptr);
+        mappingHandle = std::exchange(other.mappingHandle, nullptr);
+#endif
+    }
+    return *this;
+}
+
+bool MappedFile::IsOpen() const {
+    return isOpen;
+}
+
+const u8 *MappedFile::GetData(size_t &size) const {
+    size = this->size;
+    return data;
+}
+
+void MappedFile::Close() {
+#ifdef WIN32
+    if (data != nullptr) {
+        UnmapViewOfFile(data);
+    }
+    if (mappingHandle != nullptr) {
+        CloseHandle(mappingHandle);
+    }
+    if (fileHandle != nullptr) {
+        CloseHandle(fileHandle);
+    }
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+#else
+    if (data != nullptr) {
+        munmap((void *) data, size);
+    }
+#endif
+    data = nullptr;
+    size = 0;
+    isOpen = false;
+}
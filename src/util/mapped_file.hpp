@@ -0,0 +1,32 @@
+#pragma once
+
+#include <filesystem>
+
+#include "types.h"
+
+// Read-only memory mapping of a whole file
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(const std::filesystem::path &path);
+    ~MappedFile();
+
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool IsOpen() const;
+    const u8 *GetData(size_t &size) const;
+
+private:
+    void Close();
+
+    const u8 *data = nullptr;
+    size_t size = 0;
+    bool isOpen = false;
+#ifdef WIN32
+    void *fileHandle = nullptr;
+    void *mappingHandle = nullptr;
+#endif
+};
@@ -0,0 +1,318 @@
+#include "profiler.hpp"
+
+#ifdef AINBY_PROFILER
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+// Events kept per thread, must be a power of two
+#define PROFILER_BUFFER_SIZE ((u64) 1 << 17)
+#define PROFILER_FRAME_HISTORY 256
+// How often a running trace copies the buffers to its file, well before they wrap around
+#define TRACE_FLUSH_INTERVAL_MS 100
+
+namespace {
+
+struct ThreadBuffer {
+    std::string name;
+    std::unique_ptr<Profiler::Event[]> events = std::make_unique<Profiler::Event[]>(PROFILER_BUFFER_SIZE);
+    // Only written by the owning thread; events up to writeIndex - PROFILER_BUFFER_SIZE are gone
+    // or about to be overwritten
+    std::atomic<u64> writeIndex = 0;
+    // Buffers of threads that exited are handed to new threads
+    bool inUse = true;
+    // First event a running trace has not written yet
+    u64 traceIndex = 0;
+};
+
+std::mutex buffersMutex;
+std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+
+Profiler::Frame frames[PROFILER_FRAME_HISTORY];
+std::atomic<u64> frameCount = 0;
+
+// Kept apart from the buffer release below, so that recording only touches trivial thread locals
+thread_local ThreadBuffer *threadBuffer = nullptr;
+thread_local u32 threadDepth = 0;
+
+// Hands the buffer back when its thread exits
+struct ThreadBufferRelease {
+    ~ThreadBufferRelease() {
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        threadBuffer->inUse = false;
+    }
+};
+
+ThreadBuffer *AcquireThreadBuffer() {
+    thread_local ThreadBufferRelease release;
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    for (std::unique_ptr<ThreadBuffer> &buffer : buffers) {
+        if (!buffer->inUse) {
+            buffer->inUse = true;
+            return buffer.get();
+        }
+    }
+    std::unique_ptr<ThreadBuffer> &buffer = buffers.emplace_back(std::make_unique<ThreadBuffer>());
+    buffer->name = "Thread " + std::to_string(buffers.size());
+    return buffer.get();
+}
+
+ThreadBuffer *GetThreadBuffer() {
+    if (threadBuffer == nullptr) {
+        threadBuffer = AcquireThreadBuffer();
+    }
+    return threadBuffer;
+}
+
+const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+// Copies new events to the trace file from its own thread, so that long sessions
+// can be recorded without the ring buffers running over
+class TraceWriter {
+public:
+    TraceWriter(const std::string &path) : file(path, std::ios::binary) {
+        if (!file) {
+            throw std::runtime_error("Could not create trace file " + path);
+        }
+        // The closing bracket is optional in the array format, so a trace that was
+        // never stopped (e.g. after a crash) still opens
+        file << "[";
+        WriteMetadata(0, "Frames");
+
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        for (std::unique_ptr<ThreadBuffer> &buffer : buffers) {
+            buffer->traceIndex = buffer->writeIndex.load(std::memory_order_acquire);
+        }
+        frameIndex = frameCount.load(std::memory_order_acquire);
+        thread = std::thread(&TraceWriter::Run, this);
+    }
+
+    ~TraceWriter() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        wake.notify_one();
+        thread.join();
+        Flush();
+
+        // Written last, so that threads get the names they were given while recording
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        for (size_t i = 0; i < buffers.size(); i++) {
+            WriteMetadata(i + 1, buffers[i]->name);
+        }
+        if (droppedEvents > 0) {
+            WriteInstant("Dropped events", droppedEvents);
+        }
+        file << "\n]\n";
+    }
+
+private:
+    void Run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!stop) {
+            wake.wait_for(lock, std::chrono::milliseconds(TRACE_FLUSH_INTERVAL_MS));
+            if (!stop) {
+                Flush();
+            }
+        }
+    }
+
+    void Flush() {
+        pending.clear();
+        {
+            std::lock_guard<std::mutex> lock(buffersMutex);
+            for (size_t i = 0; i < buffers.size(); i++) {
+                ThreadBuffer &buffer = *buffers[i];
+                u64 end = buffer.writeIndex.load(std::memory_order_acquire);
+                u64 first = buffer.traceIndex;
+                if (end - first > PROFILER_BUFFER_SIZE) {
+                    droppedEvents += end - PROFILER_BUFFER_SIZE - first;
+                    first = end - PROFILER_BUFFER_SIZE;
+                }
+                size_t copied = pending.size();
+                for (u64 idx = first; idx < end; idx++) {
+                    pending.push_back({ (u32) i + 1, buffer.events[idx & (PROFILER_BUFFER_SIZE - 1)] });
+                }
+
+                // Same as in Collect, drop what the thread overwrote while this copied
+                std::atomic_thread_fence(std::memory_order_acquire);
+                u64 written = buffer.writeIndex.load(std::memory_order_relaxed);
+                if (written + 1 > PROFILER_BUFFER_SIZE && written + 1 - PROFILER_BUFFER_SIZE > first) {
+                    u64 overwritten = std::min(written + 1 - PROFILER_BUFFER_SIZE - first, (u64) (pending.size() - copied));
+                    pending.erase(pending.begin() + copied, pending.begin() + copied + overwritten);
+                    droppedEvents += overwritten;
+                }
+                buffer.traceIndex = end;
+            }
+        }
+
+        u64 count = frameCount.load(std::memory_order_acquire);
+        // The oldest slot may already be getting overwritten by the next frame
+        u64 firstFrame = count >= PROFILER_FRAME_HISTORY ? count - PROFILER_FRAME_HISTORY + 1 : 0;
+        if (frameIndex < firstFrame) {
+            droppedEvents += firstFrame - frameIndex;
+            frameIndex = firstFrame;
+        }
+        for (; frameIndex < count; frameIndex++) {
+            const Profiler::Frame &frame = frames[frameIndex % PROFILER_FRAME_HISTORY];
+            WriteEvent(0, "Frame", frame.start, frame.end);
+        }
+        for (const auto &[tid, event] : pending) {
+            WriteEvent(tid, event.name, event.start, event.end);
+        }
+        file.flush();
+    }
+
+    // Timestamps are in microseconds
+    void WriteEvent(u32 tid, const char *name, u64 start, u64 end) {
+        char line[128];
+        snprintf(line, sizeof(line), "\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", tid, start / 1e3,
+            (end - start) / 1e3);
+        BeginEvent();
+        file << "{\"name\":\"";
+        WriteEscaped(name);
+        file << line;
+    }
+
+    void WriteInstant(const char *name, u64 value) {
+        BeginEvent();
+        file << "{\"name\":\"" << name << "\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":"
+             << Profiler::Now() / 1e3 << ",\"args\":{\"count\":" << value << "}}";
+    }
+
+    void WriteMetadata(u32 tid, const std::string &name) {
+        BeginEvent();
+        file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid << ",\"args\":{\"name\":\"";
+        WriteEscaped(name.c_str());
+        file << "\"}}";
+    }
+
+    void BeginEvent() {
+        file << (firstEvent ? "\n" : ",\n");
+        firstEvent = false;
+    }
+
+    void WriteEscaped(const char *str) {
+        for (; *str != '\0'; str++) {
+            if (*str == '"' || *str == '\\') {
+                file << '\\';
+            }
+            file << *str;
+        }
+    }
+
+    std::ofstream file;
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stop = false;
+
+    bool firstEvent = true;
+    u64 frameIndex = 0;
+    u64 droppedEvents = 0;
+    // Events copied out of the buffers and the track they go on
+    std::vector<std::pair<u32, Profiler::Event>> pending;
+};
+
+std::mutex traceMutex;
+std::unique_ptr<TraceWriter> trace;
+
+} // namespace
+
+Profiler::Scope::Scope(const char *name) : name(name), start(Now()) {
+    threadDepth++;
+}
+
+Profiler::Scope::~Scope() {
+    u64 end = Now();
+    ThreadBuffer *buffer = GetThreadBuffer();
+    u32 depth = --threadDepth;
+    u64 idx = buffer->writeIndex.load(std::memory_order_relaxed);
+    buffer->events[idx & (PROFILER_BUFFER_SIZE - 1)] = { name, start, end, depth };
+    buffer->writeIndex.store(idx + 1, std::memory_order_release);
+}
+
+u64 Profiler::Now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+void Profiler::SetThreadName(const char *name) {
+    ThreadBuffer *buffer = GetThreadBuffer();
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    buffer->name = name;
+}
+
+Profiler::FrameScope::FrameScope() : start(Now()) {}
+
+Profiler::FrameScope::~FrameScope() {
+    u64 frame = frameCount.load(std::memory_order_relaxed);
+    frames[frame % PROFILER_FRAME_HISTORY] = { start, Now() };
+    frameCount.store(frame + 1, std::memory_order_release);
+}
+
+void Profiler::Collect(u64 since, std::vector<Thread> &threads) {
+    threads.clear();
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    for (const std::unique_ptr<ThreadBuffer> &buffer : buffers) {
+        Thread &thread = threads.emplace_back();
+        thread.name = buffer->name;
+
+        u64 end = buffer->writeIndex.load(std::memory_order_acquire);
+        u64 begin = end > PROFILER_BUFFER_SIZE ? end - PROFILER_BUFFER_SIZE : 0;
+        // Events are recorded when they end, so the wanted ones are at the back
+        u64 first = end;
+        while (first > begin && buffer->events[(first - 1) & (PROFILER_BUFFER_SIZE - 1)].end >= since) {
+            first--;
+        }
+        for (u64 i = first; i < end; i++) {
+            thread.events.push_back(buffer->events[i & (PROFILER_BUFFER_SIZE - 1)]);
+        }
+
+        // The thread keeps recording while this copies, drop what it overwrote in the meantime.
+        // The oldest slot may already be getting overwritten by the next event. The fence
+        // keeps the copies above from being read after writeIndex.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        u64 written = buffer->writeIndex.load(std::memory_order_relaxed);
+        if (written + 1 > PROFILER_BUFFER_SIZE && written + 1 - PROFILER_BUFFER_SIZE > first) {
+            u64 overwritten = std::min(written + 1 - PROFILER_BUFFER_SIZE - first, (u64) thread.events.size());
+            thread.events.erase(thread.events.begin(), thread.events.begin() + overwritten);
+        }
+    }
+}
+
+std::vector<Profiler::Frame> Profiler::GetFrames() {
+    u64 count = frameCount.load(std::memory_order_acquire);
+    u64 first = count > PROFILER_FRAME_HISTORY ? count - PROFILER_FRAME_HISTORY : 0;
+    std::vector<Frame> result;
+    for (u64 frame = first; frame < count; frame++) {
+        result.push_back(frames[frame % PROFILER_FRAME_HISTORY]);
+    }
+    return result;
+}
+
+void Profiler::StartTrace(const std::string &path) {
+    std::lock_guard<std::mutex> lock(traceMutex);
+    trace.reset();
+    trace = std::make_unique<TraceWriter>(path);
+}
+
+void Profiler::StopTrace() {
+    std::lock_guard<std::mutex> lock(traceMutex);
+    trace.reset();
+}
+
+bool Profiler::IsTracing() {
+    std::lock_guard<std::mutex> lock(traceMutex);
+    return trace != nullptr;
+}
+
+#endif
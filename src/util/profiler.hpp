@@ -0,0 +1,91 @@
+#pragma once
+
+#include "types.h"
+
+// Scoped timers for finding out where frame (and load) time goes. Names have to be
+// string literals, only the pointer is recorded. Without AINBY_PROFILER all of
+// this compiles to nothing.
+#ifdef AINBY_PROFILER
+
+#include <string>
+#include <vector>
+
+#define AINBY_PROFILE_CONCAT_INNER(a, b) a##b
+#define AINBY_PROFILE_CONCAT(a, b) AINBY_PROFILE_CONCAT_INNER(a, b)
+#define AINBY_PROFILE_SCOPE(name) Profiler::Scope AINBY_PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define AINBY_PROFILE_FRAME() Profiler::FrameScope profileFrame
+#define AINBY_PROFILE_THREAD(name) Profiler::SetThreadName(name)
+
+// Every thread records into its own ring buffer, so recording never takes a lock.
+// Old events are overwritten once a buffer is full.
+class Profiler {
+public:
+    struct Event {
+        const char *name;
+        // Nanoseconds since the profiler started
+        u64 start;
+        u64 end;
+        // Number of scopes this one is nested in
+        u32 depth;
+    };
+
+    struct Frame {
+        u64 start;
+        u64 end;
+    };
+
+    struct Thread {
+        std::string name;
+        // Sorted by end time
+        std::vector<Event> events;
+    };
+
+    class Scope {
+    public:
+        Scope(const char *name);
+        ~Scope();
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        const char *name;
+        u64 start;
+    };
+
+    // Spans everything the main loop does for one frame, but not the waiting for input
+    class FrameScope {
+    public:
+        FrameScope();
+        ~FrameScope();
+
+        FrameScope(const FrameScope &) = delete;
+        FrameScope &operator=(const FrameScope &) = delete;
+
+    private:
+        u64 start;
+    };
+
+    static u64 Now();
+    static void SetThreadName(const char *name);
+
+    // Copies the recorded events that ended at or after since
+    static void Collect(u64 since, std::vector<Thread> &threads);
+    // The recent frames, oldest first
+    static std::vector<Frame> GetFrames();
+
+    // Streams every event and frame from now on to a Chrome trace-event file (JSON
+    // array format, opens in Perfetto or chrome://tracing) until StopTrace is called.
+    // Throws if the file can't be created.
+    static void StartTrace(const std::string &path);
+    static void StopTrace();
+    static bool IsTracing();
+};
+
+#else
+
+#define AINBY_PROFILE_SCOPE(name)
+#define AINBY_PROFILE_FRAME()
+#define AINBY_PROFILE_THREAD(name)
+
+#endif
@@ -0,0 +1,121 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+
+#include "util/profiler.hpp"
+
+// Index of the worker the current thread belongs to, if any
+static thread_local const ThreadPool *currentPool = nullptr;
+static thread_local size_t currentWorker = 0;
+
+ThreadPool::ThreadPool(size_t threadCount) {
+    threadCount = std::max<size_t>(threadCount, 1);
+    for (size_t i = 0; i < threadCount; i++) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    for (size_t i = 0; i < threadCount; i++) {
+        threads.emplace_back(&ThreadPool::WorkerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+    size_t idx = (currentPool == this) ? currentWorker : nextQueue++ % queues.size();
+    {
+        std::lock_guard<std::mutex> lock(queues[idx]->mutex);
+        queues[idx]->tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        queuedTasks++;
+        unfinishedTasks++;
+    }
+    workAvailable.notify_one();
+}
+
+void ThreadPool::Wait() {
+    std::unique_lock<std::mutex> lock(stateMutex);
+    allDone.wait(lock, [this] { return unfinishedTasks == 0; });
+    if (firstException) {
+        std::exception_ptr e = firstException;
+        firstException = nullptr;
+        std::rethrow_exception(e);
+    }
+}
+
+size_t ThreadPool::GetThreadCount() const {
+    return threads.size();
+}
+
+void ThreadPool::WorkerLoop(size_t idx) {
+    currentPool = this;
+    currentWorker = idx;
+    AINBY_PROFILE_THREAD("Worker");
+
+    std::function<void()> task;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(stateMutex);
+            workAvailable.wait(lock, [this] { return stopping || queuedTasks > 0; });
+            if (queuedTasks == 0) {
+                return;
+            }
+            // Reserve a task; one is guaranteed to be in some queue
+            queuedTasks--;
+        }
+
+        while (!TryPop(idx, task)) {
+            // The reserved task was pushed to a queue after its counter was taken, retry
+            std::this_thread::yield();
+        }
+
+        try {
+            task();
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            if (!firstException) {
+                firstException = std::current_exception();
+            }
+        }
+        task = nullptr;
+
+        std::lock_guard<std::mutex> lock(stateMutex);
+        if (--unfinishedTasks == 0) {
+            allDone.notify_all();
+        }
+    }
+}
+
+bool ThreadPool::TryPop(size_t idx, std::function<void()> &task) {
+    // Own queue first (newest task, it's most likely still in cache)...
+    {
+        Queue &queue = *queues[idx];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            return true;
+        }
+    }
+    // ...then steal the oldest task of another worker
+    for (size_t i = 1; i < queues.size(); i++) {
+        Queue &queue = *queues[(idx + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
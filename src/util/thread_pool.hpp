@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool. Every worker has its own queue; tasks submitted
+// from a worker go to that worker's queue (and are taken newest first), idle
+// workers steal the oldest tasks from the others.
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threadCount = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    void Submit(std::function<void()> task);
+    // Blocks until all submitted tasks (including ones submitted by tasks) are done.
+    // Rethrows the first exception thrown by a task, if any.
+    void Wait();
+
+    size_t GetThreadCount() const;
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void WorkerLoop(size_t idx);
+    bool TryPop(size_t idx, std::function<void()> &task);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+
+    std::mutex stateMutex;
+    std::condition_variable workAvailable;
+    std::condition_variable allDone;
+    size_t queuedTasks = 0;
+    size_t unfinishedTasks = 0;
+    bool stopping = false;
+    std::exception_ptr firstException;
+
+    std::atomic<size_t> nextQueue = 0;
+};
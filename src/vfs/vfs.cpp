@@ -0,0 +1,330 @@
+#include "vfs.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "file_formats/format.hpp"
+#include "file_formats/sarc.hpp"
+#include "file_formats/zstd.hpp"
+#include "util/archive_cache.hpp"
+#include "util/mapped_file.hpp"
+#include "util/profiler.hpp"
+
+namespace fs = std::filesystem;
+
+// Memory accounted for a mounted seekable archive (decompression context and window)
+#define SEEKABLE_ARCHIVE_MEMORY (256 << 10)
+// Also limits the number of open file handles
+#define MAX_LOADED_ARCHIVES 256
+
+std::shared_ptr<const void> UnwrapZSTD(const u8 *&data, size_t &size, std::shared_ptr<const void> backing, ArchiveCache *cache) {
+    AINBY_PROFILE_SCOPE("UnwrapZSTD");
+    if (DetectFormat(data, size) != FileFormat::ZSTD) {
+        return backing;
+    }
+    if (cache != nullptr) {
+        std::shared_ptr<MappedFile> mapped = std::make_shared<MappedFile>(cache->Open(data, size));
+        data = mapped->GetData(size);
+        return mapped;
+    }
+    std::shared_ptr<ZSTD> zstdFile = std::make_shared<ZSTD>();
+    zstdFile->Read(data, size);
+    data = zstdFile->GetData(size);
+    return zstdFile;
+}
+
+VFS::VFS(size_t memoryBudget) : memoryBudget(memoryBudget) {}
+
+VFS::~VFS() = default;
+
+void VFS::Mount(const fs::path &romfsRoot) {
+    std::vector<std::string> files;
+    for (const fs::directory_entry &entry : fs::recursive_directory_iterator(romfsRoot)) {
+        if (entry.is_regular_file()) {
+            files.push_back(fs::relative(entry.path(), romfsRoot).generic_string());
+        }
+    }
+    std::sort(files.begin(), files.end());
+
+    std::lock_guard<std::mutex> lock(mutex);
+    root = romfsRoot;
+    hostFiles = std::make_shared<std::vector<std::string>>(std::move(files));
+    entries.clear();
+    archiveIndex.clear();
+    archives.clear();
+    loadedArchives.clear();
+    memoryUsage = 0;
+
+    entries.reserve(hostFiles->size());
+    for (size_t i = 0; i < hostFiles->size(); i++) {
+        entries[(*hostFiles)[i]] = Entry { -1, (u32) i, 0 };
+    }
+    mounted = true;
+}
+
+void VFS::Unmount() {
+    std::lock_guard<std::mutex> lock(mutex);
+    root.clear();
+    hostFiles = std::make_shared<std::vector<std::string>>();
+    entries.clear();
+    archiveIndex.clear();
+    archives.clear();
+    loadedArchives.clear();
+    memoryUsage = 0;
+    mounted = false;
+}
+
+bool VFS::IsMounted() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return mounted;
+}
+
+void VFS::SetArchiveCache(ArchiveCache *cache) {
+    std::lock_guard<std::mutex> lock(mutex);
+    this->cache = cache;
+}
+
+bool VFS::Exists(const std::string &path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    try {
+        return Resolve(path) != nullptr;
+    } catch (std::exception &) {
+        // Something along the path could not be mounted
+        return false;
+    }
+}
+
+VFS::File VFS::Open(const std::string &path) {
+    AINBY_PROFILE_SCOPE("VFS::Open");
+    std::lock_guard<std::mutex> lock(mutex);
+    const Entry *entry = Resolve(path);
+    if (entry == nullptr) {
+        throw std::runtime_error("File not found: " + path);
+    }
+    return ReadEntry(*entry);
+}
+
+std::vector<std::string> VFS::List(const std::string &archivePath) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = archiveIndex.find(archivePath);
+    if (it != archiveIndex.end()) {
+        return archives[it->second].files;
+    }
+
+    const Entry *entry = Resolve(archivePath);
+    if (entry == nullptr) {
+        throw std::runtime_error("File not found: " + archivePath);
+    }
+    s32 idx = MountArchive(archivePath, *entry);
+    return archives[idx].files;
+}
+
+std::shared_ptr<const std::vector<std::string>> VFS::GetHostFiles() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return hostFiles;
+}
+
+const VFS::Entry *VFS::Resolve(const std::string &path) {
+    auto it = entries.find(path);
+    if (it != entries.end()) {
+        return &it->second;
+    }
+
+    // Not indexed yet, so mount every archive along the path that isn't mounted already
+    for (size_t pos = path.find('/'); pos != std::string::npos; pos = path.find('/', pos + 1)) {
+        std::string prefix = path.substr(0, pos);
+        if (archiveIndex.find(prefix) != archiveIndex.end()) {
+            continue;
+        }
+        auto prefixIt = entries.find(prefix);
+        if (prefixIt == entries.end()) {
+            // Just a directory
+            continue;
+        }
+        MountArchive(prefix, prefixIt->second);
+
+        it = entries.find(path);
+        if (it != entries.end()) {
+            return &it->second;
+        }
+    }
+    return nullptr;
+}
+
+s32 VFS::MountArchive(const std::string &path, const Entry &source) {
+    auto it = archiveIndex.find(path);
+    if (it != archiveIndex.end()) {
+        return it->second;
+    }
+
+    s32 idx = archives.size();
+    archives.emplace_back();
+    archives[idx].path = path;
+    archives[idx].source = source;
+
+    std::unordered_map<std::string, SARC::FileEntry> index;
+    try {
+        LoadArchive(idx);
+        Archive &archive = archives[idx];
+        if (archive.seekable == nullptr && DetectFormat(archive.data, archive.size) != FileFormat::SARC) {
+            throw std::runtime_error(path + " is not an archive");
+        }
+        index = SARC::ReadIndex([&](u8 *dest, size_t offset, size_t size) {
+            ReadArchive(archive, dest, offset, size);
+        });
+    } catch (std::exception &) {
+        UnloadArchive(idx);
+        archives.pop_back();
+        throw;
+    }
+
+    Archive &archive = archives[idx];
+    archive.files.reserve(index.size());
+    for (const auto &[name, fileEntry] : index) {
+        entries[path + "/" + name] = Entry { idx, fileEntry.offset, fileEntry.size };
+        archive.files.push_back(name);
+    }
+    std::sort(archive.files.begin(), archive.files.end());
+    archiveIndex[path] = idx;
+
+    EnforceBudget(idx);
+    return idx;
+}
+
+void VFS::LoadArchive(s32 idx) {
+    if (archives[idx].loaded) {
+        return;
+    }
+
+    Entry source = archives[idx].source;
+    if (source.archive < 0) {
+        // Seekable files on the host can be read without decompressing them fully
+        fs::path hostPath = root / (*hostFiles)[source.offset];
+        std::unique_ptr<std::ifstream> file = std::make_unique<std::ifstream>(hostPath, std::ios::binary);
+        if (*file && ZSTD::IsSeekable(*file)) {
+            Archive &archive = archives[idx];
+            archive.seekable = std::make_unique<ZSTDSeekable>(*file);
+            archive.seekableFile = std::move(file);
+            archive.size = archive.seekable->GetDecompressedSize();
+            archive.memoryUsage = SEEKABLE_ARCHIVE_MEMORY;
+            archive.loaded = true;
+            memoryUsage += archive.memoryUsage;
+            loadedArchives.push_back(idx);
+            return;
+        }
+    }
+
+    File file = ReadEntry(source);
+    const u8 *data = file.data;
+    size_t size = file.size;
+    std::shared_ptr<const void> backing = UnwrapZSTD(data, size, file.backing, cache);
+
+    Archive &archive = archives[idx];
+    // Uncompressed archives inside of other archives are just views into their parent,
+    // the parent is charged for the memory and unloads them together with itself.
+    // Entries of seekable parents are copies and are charged like any other archive.
+    archive.isView = source.archive >= 0 && backing == archives[source.archive].backing;
+    archive.memoryUsage = archive.isView ? 0 : size;
+    archive.backing = std::move(backing);
+    archive.data = data;
+    archive.size = size;
+    archive.loaded = true;
+    memoryUsage += archive.memoryUsage;
+    loadedArchives.push_back(idx);
+}
+
+void VFS::UnloadArchive(s32 idx) {
+    Archive &archive = archives[idx];
+    if (!archive.loaded) {
+        return;
+    }
+    memoryUsage -= archive.memoryUsage;
+    archive.loaded = false;
+    archive.backing.reset();
+    archive.data = nullptr;
+    archive.size = 0;
+    archive.memoryUsage = 0;
+    archive.isView = false;
+    archive.seekable.reset();
+    archive.seekableFile.reset();
+    loadedArchives.erase(std::find(loadedArchives.begin(), loadedArchives.end(), idx));
+
+    // Views would otherwise keep the parent's data alive without being charged for it
+    std::vector<s32> views;
+    for (s32 other : loadedArchives) {
+        if (archives[other].isView && archives[other].source.archive == idx) {
+            views.push_back(other);
+        }
+    }
+    for (s32 view : views) {
+        UnloadArchive(view);
+    }
+}
+
+void VFS::ReadArchive(Archive &archive, u8 *dest, size_t offset, size_t size) {
+    if (archive.seekable != nullptr) {
+        archive.seekable->Read(dest, offset, size);
+        return;
+    }
+    if (offset + size > archive.size) {
+        throw std::runtime_error("Unexpected end of archive " + archive.path);
+    }
+    memcpy(dest, archive.data + offset, size);
+}
+
+void VFS::EnforceBudget(s32 keep) {
+    // Unloading a parent unloads its views, so the parents keep is a view into stay, too
+    auto isNeeded = [&](s32 idx) {
+        for (s32 needed = keep; needed >= 0; needed = archives[needed].isView ? archives[needed].source.archive : -1) {
+            if (needed == idx) {
+                return true;
+            }
+        }
+        return false;
+    };
+    while ((memoryUsage > memoryBudget || loadedArchives.size() > MAX_LOADED_ARCHIVES) && loadedArchives.size() > 1) {
+        s32 oldest = -1;
+        for (s32 idx : loadedArchives) {
+            if (!isNeeded(idx) && (oldest == -1 || archives[idx].lastUse < archives[oldest].lastUse)) {
+                oldest = idx;
+            }
+        }
+        if (oldest == -1) {
+            break;
+        }
+        UnloadArchive(oldest);
+    }
+}
+
+VFS::File VFS::ReadEntry(const Entry &entry) {
+    if (entry.archive < 0) {
+        std::shared_ptr<MappedFile> mapped = std::make_shared<MappedFile>(root / (*hostFiles)[entry.offset]);
+        File file;
+        file.data = mapped->GetData(file.size);
+        file.backing = std::move(mapped);
+        return file;
+    }
+
+    LoadArchive(entry.archive);
+    Archive &archive = archives[entry.archive];
+    archive.lastUse = ++useCounter;
+
+    File file;
+    if (archive.seekable != nullptr) {
+        std::shared_ptr<std::vector<u8>> buffer = std::make_shared<std::vector<u8>>(entry.size);
+        ReadArchive(archive, buffer->data(), entry.offset, entry.size);
+        file.data = buffer->data();
+        file.size = entry.size;
+        file.backing = std::move(buffer);
+    } else {
+        if ((size_t) entry.offset + entry.size > archive.size) {
+            throw std::runtime_error("Unexpected end of archive " + archive.path);
+        }
+        file.backing = archive.backing;
+        file.data = archive.data + entry.offset;
+        file.size = entry.size;
+    }
+
+    EnforceBudget(entry.archive);
+    return file;
+}
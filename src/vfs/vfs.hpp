@@ -0,0 +1,104 @@
+#pragma once
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "types.h"
+
+class ArchiveCache;
+class ZSTDSeekable;
+
+// If data is zstd compressed, decompresses it (through the cache if one is given) and
+// updates data/size to point to the result. Returns whatever keeps the data alive,
+// which is backing itself if nothing had to be done.
+std::shared_ptr<const void> UnwrapZSTD(const u8 *&data, size_t &size, std::shared_ptr<const void> backing, ArchiveCache *cache);
+
+// Virtual filesystem over a romfs dump. Archives (SARC files, optionally zstd
+// compressed) act as directories and are mounted lazily when a path goes
+// through them, e.g. "Pack/Actor/Foo.pack.zs/AI/Bar.root.ainb". Once an archive
+// has been mounted, its files resolve with a single hash lookup.
+//
+// Archive contents are kept in memory up to a budget, after which the least
+// recently used archives are unloaded again (their indexes stay around, so they
+// are reloaded transparently on the next access). Seekable .zs files never get
+// fully decompressed, only the frames of the requested files are.
+//
+// All functions are thread safe.
+class VFS {
+public:
+    // A file's data. Keeps the archive it lives in alive, even if it gets unloaded.
+    struct File {
+        std::shared_ptr<const void> backing;
+        const u8 *data = nullptr;
+        size_t size = 0;
+    };
+
+    VFS(size_t memoryBudget = (size_t) 512 << 20);
+    ~VFS();
+
+    void Mount(const std::filesystem::path &romfsRoot);
+    void Unmount();
+    bool IsMounted() const;
+    void SetArchiveCache(ArchiveCache *cache);
+
+    bool Exists(const std::string &path);
+    File Open(const std::string &path);
+    // Files contained in the archive at the given path, relative to it
+    std::vector<std::string> List(const std::string &archivePath);
+    // All files of the romfs dump (relative to its root), sorted. The list stays
+    // valid after a later Mount or Unmount, it just isn't updated.
+    std::shared_ptr<const std::vector<std::string>> GetHostFiles() const;
+
+private:
+    struct Entry {
+        // -1 for files on the host filesystem, in which case offset is an index into hostFiles
+        s32 archive;
+        u32 offset;
+        u32 size;
+    };
+    struct Archive {
+        std::string path;
+        Entry source;
+        std::vector<std::string> files;
+
+        // Only valid while loaded
+        bool loaded = false;
+        std::shared_ptr<const void> backing;
+        const u8 *data = nullptr;
+        size_t size = 0;
+        size_t memoryUsage = 0;
+        // Uncompressed archive inside of another one, its data is a view into the parent's
+        bool isView = false;
+        std::unique_ptr<std::ifstream> seekableFile;
+        std::unique_ptr<ZSTDSeekable> seekable;
+        u64 lastUse = 0;
+    };
+
+    const Entry *Resolve(const std::string &path);
+    s32 MountArchive(const std::string &path, const Entry &source);
+    void LoadArchive(s32 idx);
+    void UnloadArchive(s32 idx);
+    void ReadArchive(Archive &archive, u8 *dest, size_t offset, size_t size);
+    void EnforceBudget(s32 keep);
+    File ReadEntry(const Entry &entry);
+
+    mutable std::mutex mutex;
+    std::filesystem::path root;
+    bool mounted = false;
+    ArchiveCache *cache = nullptr;
+
+    std::shared_ptr<const std::vector<std::string>> hostFiles = std::make_shared<std::vector<std::string>>();
+    std::unordered_map<std::string, Entry> entries;
+    std::unordered_map<std::string, s32> archiveIndex;
+    std::vector<Archive> archives;
+    std::vector<s32> loadedArchives;
+
+    size_t memoryBudget;
+    size_t memoryUsage = 0;
+    u64 useCounter = 0;
+};
@@ -0,0 +1,381 @@
+// Headless frame time benchmark of the node viewer. Draws AINB files through
+// AINBEditor without a window or renderer and reports per-frame CPU time, the size
+// of the generated draw data and heap allocations at a few zoom and pan positions.
+#include <imgui.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <strstream>
+#include <vector>
+
+#include "ainb_editor/ainb_editor.hpp"
+#include "file_formats/ainb.hpp"
+#include "node_editor/imgui_canvas.h"
+#include "synthetic_ainb.hpp"
+#include "util/hash.hpp"
+#include "util/mapped_file.hpp"
+#include "util/profiler.hpp"
+#include "vfs/vfs.hpp"
+
+#define DEFAULT_FRAMES 300
+#define DEFAULT_WIDTH 1920
+#define DEFAULT_HEIGHT 1080
+// Width of the inspector next to the node viewer, like the default docked layout
+#define INSPECTOR_WIDTH 400
+// Frames to wait at most for the initial layout before giving up
+#define MAX_WARMUP_FRAMES 100000
+#define TRANSFORM_VERTEX_COUNT (1 << 20)
+#define TRANSFORM_RUNS 20
+
+// Counts every heap allocation of the process, the per-frame difference tells
+// whether drawing allocates once the buffers have grown to their final size
+static std::atomic<u64> allocationCount = 0;
+
+void *operator new(size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void *ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+static void *CountingAlloc(size_t size, void *) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size);
+}
+
+static void CountingFree(void *ptr, void *) {
+    std::free(ptr);
+}
+
+struct Options {
+    std::vector<std::string> files;
+    std::vector<u32> syntheticNodeCounts;
+    u32 frames = DEFAULT_FRAMES;
+    float width = DEFAULT_WIDTH;
+    float height = DEFAULT_HEIGHT;
+    // Most allocations any frame of a fixed view may make (after its first), no limit if negative
+    s64 maxAllocs = -1;
+    // Chrome trace of the whole run, not written if empty
+    std::string tracePath;
+};
+
+struct FrameStats {
+    double ms;
+    u32 vertices;
+    u32 indices;
+    u32 commands;
+    u64 allocations;
+};
+
+// A view of the graph, see AINBEditor::SetView. Pans move the center from
+// center to panEnd over the frames of the scenario.
+struct Scenario {
+    const char *name;
+    ImVec2 center;
+    float zoom;
+    bool pan;
+    ImVec2 panEnd;
+};
+
+static const Scenario scenarios[] = {
+    { "overview", ImVec2(0.5f, 0.5f), 0.0f, false, ImVec2() },
+    { "zoom 0.25", ImVec2(0.5f, 0.5f), 0.25f, false, ImVec2() },
+    { "zoom 1.0", ImVec2(0.5f, 0.5f), 1.0f, false, ImVec2() },
+    { "corner 1.0", ImVec2(0.1f, 0.1f), 1.0f, false, ImVec2() },
+    { "pan 0.5", ImVec2(0.0f, 0.5f), 0.5f, true, ImVec2(1.0f, 0.5f) },
+};
+
+static int PrintUsage() {
+    std::cerr
+        << "Usage:\n"
+        << "  ainby_bench [<file.ainb|file.ainb.zs>...] [--synthetic <node count>]... [--frames <count>]\n"
+        << "              [--width <pixels>] [--height <pixels>] [--max-allocs <count>] [--trace <file.json>]\n"
+        << "  ainby_bench --transform\n";
+    return 1;
+}
+
+static double Percentile(std::vector<double> values, double p) {
+    std::sort(values.begin(), values.end());
+    return values[(size_t) std::round(p * (values.size() - 1))];
+}
+
+static FrameStats DrawFrame(AINBEditor &editor, const Options &options) {
+    AINBY_PROFILE_FRAME();
+    FrameStats stats;
+    u64 allocationsBefore = allocationCount.load(std::memory_order_relaxed);
+    auto start = std::chrono::steady_clock::now();
+
+    ImGui::NewFrame();
+    ImGui::SetNextWindowPos(ImVec2(0, 0));
+    ImGui::SetNextWindowSize(ImVec2(INSPECTOR_WIDTH, options.height));
+    ImGui::Begin("AINB Inspector");
+    editor.DrawInspector();
+    ImGui::End();
+    ImGui::SetNextWindowPos(ImVec2(INSPECTOR_WIDTH, 0));
+    ImGui::SetNextWindowSize(ImVec2(options.width - INSPECTOR_WIDTH, options.height));
+    ImGui::Begin("Node Viewer");
+    editor.DrawNodeEditor();
+    ImGui::End();
+    ImGui::Render();
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    stats.ms = elapsed.count();
+    stats.allocations = allocationCount.load(std::memory_order_relaxed) - allocationsBefore;
+
+    ImDrawData *drawData = ImGui::GetDrawData();
+    stats.vertices = drawData->TotalVtxCount;
+    stats.indices = drawData->TotalIdxCount;
+    stats.commands = 0;
+    for (int i = 0; i < drawData->CmdListsCount; i++) {
+        stats.commands += drawData->CmdLists[i]->CmdBuffer.Size;
+    }
+    return stats;
+}
+
+// Returns the most allocations any frame after the first of a fixed view made. Pans
+// are left out, nodes coming into view may still grow buffers there.
+static u64 RunScenarios(AINBEditor &editor, const Options &options) {
+    u64 maxAllocations = 0;
+    for (const Scenario &scenario : scenarios) {
+        std::vector<FrameStats> frames;
+        editor.SetView(scenario.center, scenario.zoom);
+        for (u32 i = 0; i < options.frames; i++) {
+            if (scenario.pan && i > 0) {
+                float t = (float) i / std::max<u32>(options.frames - 1, 1);
+                ImVec2 center(scenario.center.x + (scenario.panEnd.x - scenario.center.x) * t,
+                    scenario.center.y + (scenario.panEnd.y - scenario.center.y) * t);
+                editor.SetView(center, scenario.zoom);
+            }
+            frames.push_back(DrawFrame(editor, options));
+        }
+
+        std::vector<double> times;
+        FrameStats max = {};
+        // The first frame of a view may still grow buffers, later ones should not allocate
+        for (size_t i = 1; i < frames.size(); i++) {
+            times.push_back(frames[i].ms);
+            max.vertices = std::max(max.vertices, frames[i].vertices);
+            max.indices = std::max(max.indices, frames[i].indices);
+            max.commands = std::max(max.commands, frames[i].commands);
+            max.allocations = std::max(max.allocations, frames[i].allocations);
+        }
+        if (times.empty()) {
+            continue;
+        }
+        if (!scenario.pan) {
+            maxAllocations = std::max(maxAllocations, max.allocations);
+        }
+
+        printf("  %-12s p50 %7.3f ms  p90 %7.3f ms  p99 %7.3f ms  max %7.3f ms  %8u vtx  %8u idx  %6u cmds  %4llu allocs\n",
+            scenario.name, Percentile(times, 0.5), Percentile(times, 0.9), Percentile(times, 0.99),
+            *std::max_element(times.begin(), times.end()), max.vertices, max.indices, max.commands,
+            (unsigned long long) max.allocations);
+    }
+    return maxAllocations;
+}
+
+// Draws one AINB through all scenarios, returns false if a frame allocated more than allowed
+static bool Benchmark(const std::string &label, const u8 *data, size_t size, const Options &options) {
+    std::istrstream stream((const char *) data, size);
+    AINB ainb;
+    ainb.Read(stream);
+
+    AINBEditor editor;
+    editor.RegisterAINB(ainb, HashData(data, size));
+
+    // Let the auto layout finish (and animate) before anything is measured
+    auto warmupStart = std::chrono::steady_clock::now();
+    u32 warmupFrames = 0;
+    do {
+        DrawFrame(editor, options);
+        warmupFrames++;
+    } while (editor.IsBusy() && warmupFrames < MAX_WARMUP_FRAMES);
+    std::chrono::duration<double, std::milli> warmup = std::chrono::steady_clock::now() - warmupStart;
+
+    printf("%s: %zu nodes, ready after %u frames (%.1f ms)\n", label.c_str(), ainb.nodes.size(), warmupFrames,
+        warmup.count());
+    u64 maxAllocations = RunScenarios(editor, options);
+    if (options.maxAllocs >= 0 && maxAllocations > (u64) options.maxAllocs) {
+        printf("  FAIL: a frame of a fixed view made %llu allocations, at most %lld are allowed\n", (unsigned long long) maxAllocations,
+            (long long) options.maxAllocs);
+        return false;
+    }
+    return true;
+}
+
+// Times the vertex and clip rect transform of the canvas against a plain scalar
+// loop and checks that both give the same result
+static bool BenchmarkTransform() {
+    std::mt19937 rng(0);
+    std::uniform_real_distribution<float> dist(-4096.0f, 4096.0f);
+    std::vector<ImDrawVert> source(TRANSFORM_VERTEX_COUNT);
+    for (ImDrawVert &vertex : source) {
+        vertex.pos = ImVec2(dist(rng), dist(rng));
+        vertex.uv = ImVec2(0, 0);
+        vertex.col = IM_COL32_WHITE;
+    }
+    std::vector<ImDrawCmd> sourceCmds(TRANSFORM_VERTEX_COUNT / 64);
+    for (ImDrawCmd &cmd : sourceCmds) {
+        cmd.ClipRect = ImVec4(dist(rng), dist(rng), dist(rng), dist(rng));
+    }
+    const float scale = 0.37f;
+    const ImVec2 offset(123.5f, -77.25f);
+
+    std::vector<ImDrawVert> expected = source;
+    std::vector<ImDrawCmd> expectedCmds = sourceCmds;
+    std::vector<ImDrawVert> actual = source;
+    std::vector<ImDrawCmd> actualCmds = sourceCmds;
+    double scalarMs = 1e30;
+    double transformMs = 1e30;
+    for (u32 run = 0; run < TRANSFORM_RUNS; run++) {
+        expected = source;
+        auto start = std::chrono::steady_clock::now();
+        for (ImDrawVert &vertex : expected) {
+            vertex.pos.x = vertex.pos.x * scale + offset.x;
+            vertex.pos.y = vertex.pos.y * scale + offset.y;
+        }
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        scalarMs = std::min(scalarMs, elapsed.count());
+
+        actual = source;
+        start = std::chrono::steady_clock::now();
+        ImGuiEx::TransformVertices(actual.data(), actual.data() + actual.size(), scale, offset);
+        elapsed = std::chrono::steady_clock::now() - start;
+        transformMs = std::min(transformMs, elapsed.count());
+    }
+    for (ImDrawCmd &cmd : expectedCmds) {
+        cmd.ClipRect = ImVec4(cmd.ClipRect.x * scale + offset.x, cmd.ClipRect.y * scale + offset.y,
+            cmd.ClipRect.z * scale + offset.x, cmd.ClipRect.w * scale + offset.y);
+    }
+    ImGuiEx::TransformClipRects(actualCmds.data(), actualCmds.data() + actualCmds.size(), scale, offset);
+
+    // The scalar loop may be compiled to fused multiply-adds, so allow for rounding
+    auto same = [](float a, float b) {
+        return std::fabs(a - b) <= 1e-5f * std::max(1.0f, std::fabs(a));
+    };
+    bool ok = true;
+    for (size_t i = 0; i < actual.size() && ok; i++) {
+        ok = same(actual[i].pos.x, expected[i].pos.x) && same(actual[i].pos.y, expected[i].pos.y)
+            && actual[i].uv.x == 0 && actual[i].col == IM_COL32_WHITE;
+    }
+    for (size_t i = 0; i < actualCmds.size() && ok; i++) {
+        const ImVec4 &a = actualCmds[i].ClipRect;
+        const ImVec4 &b = expectedCmds[i].ClipRect;
+        ok = same(a.x, b.x) && same(a.y, b.y) && same(a.z, b.z) && same(a.w, b.w);
+    }
+
+    printf("TransformVertices, %u vertices: %.3f ms (scalar loop %.3f ms, %.2fx)%s\n", TRANSFORM_VERTEX_COUNT,
+        transformMs, scalarMs, scalarMs / transformMs, ok ? "" : " MISMATCH");
+    return ok;
+}
+
+static bool ParseOptions(int argc, char **argv, Options &options) {
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--synthetic") == 0 && hasValue) {
+            options.syntheticNodeCounts.push_back(std::atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--frames") == 0 && hasValue) {
+            options.frames = std::max(std::atoi(argv[++i]), 2);
+        } else if (strcmp(argv[i], "--width") == 0 && hasValue) {
+            options.width = std::max(std::atof(argv[++i]), INSPECTOR_WIDTH + 100.0);
+        } else if (strcmp(argv[i], "--height") == 0 && hasValue) {
+            options.height = std::max(std::atof(argv[++i]), 100.0);
+        } else if (strcmp(argv[i], "--max-allocs") == 0 && hasValue) {
+            options.maxAllocs = std::atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--trace") == 0 && hasValue) {
+            options.tracePath = argv[++i];
+        } else if (strncmp(argv[i], "--", 2) == 0) {
+            return false;
+        } else {
+            options.files.push_back(argv[i]);
+        }
+    }
+    return !options.files.empty() || !options.syntheticNodeCounts.empty();
+}
+
+int main(int argc, char **argv) {
+    if (argc == 2 && strcmp(argv[1], "--transform") == 0) {
+        return BenchmarkTransform() ? 0 : 1;
+    }
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        return PrintUsage();
+    }
+
+    ImGui::SetAllocatorFunctions(CountingAlloc, CountingFree);
+    ImGui::CreateContext();
+    ImGuiIO &io = ImGui::GetIO();
+    io.IniFilename = nullptr;
+    io.DisplaySize = ImVec2(options.width, options.height);
+    io.DeltaTime = 1.0f / 60.0f;
+    // No renderer, the font atlas only has to be built
+    unsigned char *pixels;
+    int atlasWidth, atlasHeight;
+    io.Fonts->AddFontDefault();
+    io.Fonts->GetTexDataAsRGBA32(&pixels, &atlasWidth, &atlasHeight);
+
+    bool ok = true;
+    try {
+#ifdef AINBY_PROFILER
+        if (!options.tracePath.empty()) {
+            Profiler::StartTrace(options.tracePath);
+        }
+#else
+        if (!options.tracePath.empty()) {
+            throw std::runtime_error("Built without AINBY_PROFILER, can't write a trace");
+        }
+#endif
+        for (const std::string &path : options.files) {
+            MappedFile file(path);
+            size_t size;
+            const u8 *data = file.GetData(size);
+            std::shared_ptr<const void> backing = UnwrapZSTD(data, size, nullptr, nullptr);
+            ok &= Benchmark(path, data, size, options);
+        }
+        for (u32 nodeCount : options.syntheticNodeCounts) {
+            std::vector<u8> data = MakeSyntheticAINB(nodeCount, nodeCount);
+            ok &= Benchmark("synthetic " + std::to_string(nodeCount), data.data(), data.size(), options);
+        }
+    } catch (std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        ok = false;
+    }
+#ifdef AINBY_PROFILER
+    Profiler::StopTrace();
+#endif
+
+    ImGui::DestroyContext();
+    return ok ? 0 : 1;
+}
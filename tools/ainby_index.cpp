@@ -0,0 +1,97 @@
+// Command line tool for building and querying the AINB index of a romfs dump
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "index/ainb_index.hpp"
+
+static int PrintUsage() {
+    std::cerr
+        << "Usage:\n"
+        << "  ainby_index build <romfs dir> <index file> [-j <threads>]\n"
+        << "  ainby_index query <index file> <nodetype|param|gparam|embedded> <name>\n"
+        << "  ainby_index terms <index file> <nodetype|param|gparam|embedded> [<part of name>]\n"
+        << "  ainby_index stats <index file>\n";
+    return 1;
+}
+
+static int Build(int argc, char **argv) {
+    if (argc < 4) {
+        return PrintUsage();
+    }
+    size_t threadCount = std::thread::hardware_concurrency();
+    for (int i = 4; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "-j") == 0) {
+            threadCount = std::atoi(argv[i + 1]);
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    AINBIndex::BuildStats stats = AINBIndex::Build(argv[2], argv[3], threadCount);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    std::cout << "Indexed " << stats.ainbCount << " AINB files from " << stats.archiveCount << " archives in "
+              << elapsed.count() << "s (" << stats.errorCount << " errors)" << std::endl;
+    return 0;
+}
+
+static int Query(int argc, char **argv, bool listTerms) {
+    if (argc < (listTerms ? 4 : 5)) {
+        return PrintUsage();
+    }
+    AINBIndex::TermKind kind;
+    if (!AINBIndex::ParseTermKind(argv[3], kind)) {
+        return PrintUsage();
+    }
+
+    AINBIndex index;
+    index.Open(argv[2]);
+    if (listTerms) {
+        for (std::string_view term : index.FindTerms(kind, argc > 4 ? argv[4] : "")) {
+            std::cout << term << "\n";
+        }
+    } else {
+        for (std::string_view path : index.Find(kind, argv[4])) {
+            std::cout << path << "\n";
+        }
+    }
+    return 0;
+}
+
+static int Stats(int argc, char **argv) {
+    if (argc < 3) {
+        return PrintUsage();
+    }
+    AINBIndex index;
+    index.Open(argv[2]);
+    std::cout << index.GetFileCount() << " files\n";
+    for (u32 i = 0; i < AINBIndex::TermKindCount; i++) {
+        AINBIndex::TermKind kind = (AINBIndex::TermKind) i;
+        std::cout << index.GetTermCount(kind) << " " << AINBIndex::TermKindName(kind) << " terms\n";
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        return PrintUsage();
+    }
+    try {
+        if (strcmp(argv[1], "build") == 0) {
+            return Build(argc, argv);
+        } else if (strcmp(argv[1], "query") == 0) {
+            return Query(argc, argv, false);
+        } else if (strcmp(argv[1], "terms") == 0) {
+            return Query(argc, argv, true);
+        } else if (strcmp(argv[1], "stats") == 0) {
+            return Stats(argc, argv);
+        }
+    } catch (std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return PrintUsage();
+}
@@ -0,0 +1,230 @@
+#include "synthetic_ainb.hpp"
+
+#include <cstring>
+#include <random>
+#include <string>
+#include <unordered_map>
+
+#include "file_formats/ainb.hpp"
+
+namespace {
+
+// Indices of the 32-bit words in the file header
+enum HeaderWord : u32 {
+    Version = 1,
+    Name = 2,
+    CommandCount = 3,
+    NodeCount = 4,
+    GlobalParamOffset = 8,
+    StringPoolOffset = 9,
+    ImmParamOffset = 11,
+    ResidentUpdateArrOffset = 12,
+    IOParamsOffset = 13,
+    MultiParamArrOffset = 14,
+    AttachmentParamsOffset = 15,
+    ExbOffset = 17,
+    ChildReplacementTableOffset = 18,
+    PreconditionNodeArrOffset = 19,
+    EmbeddedAinbsOffset = 23,
+    FileCategory = 24,
+    EntryStringsOffset = 26,
+    X70SectionOffset = 28,
+    HeaderWordCount = 29
+};
+
+#define SYNTHETIC_AINB_VERSION 0x407
+// Number of distinct action names, so that the names repeat like in real files
+#define SYNTHETIC_ACTION_NAMES 40
+
+class Writer {
+public:
+    std::vector<u8> data;
+
+    u32 Pos() const { return data.size(); }
+    void U8(u8 v) { Raw(&v, sizeof(v)); }
+    void U16(u16 v) { Raw(&v, sizeof(v)); }
+    void U32(u32 v) { Raw(&v, sizeof(v)); }
+    void F32(f32 v) { Raw(&v, sizeof(v)); }
+    void Zeros(size_t count) { data.insert(data.end(), count, 0); }
+    void Raw(const void *src, size_t size) {
+        const u8 *bytes = (const u8 *) src;
+        data.insert(data.end(), bytes, bytes + size);
+    }
+    void PatchU32(u32 offset, u32 v) { memcpy(&data[offset], &v, sizeof(v)); }
+    void PatchHeader(HeaderWord word, u32 v) { PatchU32(word * 4, v); }
+};
+
+class StringPool {
+public:
+    u32 Add(const std::string &str) {
+        auto [it, inserted] = offsets.try_emplace(str, pool.size());
+        if (inserted) {
+            pool.append(str);
+            pool.push_back('\0');
+        }
+        return it->second;
+    }
+    const std::string &Data() const { return pool; }
+
+private:
+    std::string pool = std::string(1, '\0');
+    std::unordered_map<std::string, u32> offsets { { "", 0 } };
+};
+
+} // namespace
+
+std::vector<u8> MakeSyntheticAINB(u32 nodeCount, u32 seed) {
+    std::mt19937 rng(seed);
+    StringPool strings;
+    Writer w;
+
+    w.Zeros(HeaderWordCount * 4);
+    memcpy(w.data.data(), "AIB ", 4);
+    w.PatchHeader(Version, SYNTHETIC_AINB_VERSION);
+    w.PatchHeader(Name, strings.Add("Synthetic"));
+    w.PatchHeader(CommandCount, 1);
+    w.PatchHeader(NodeCount, nodeCount);
+    w.PatchHeader(FileCategory, strings.Add("Logic"));
+
+    // Command: name, GUID, left and right node
+    w.U32(strings.Add("Root"));
+    w.Zeros(16);
+    w.U16(0);
+    w.U16(0);
+
+    // Nodes, their parameter offsets are filled in once the parameters are written
+    std::vector<u32> paramOffsetPos(nodeCount);
+    std::vector<std::vector<u32>> children(nodeCount);
+    for (u32 i = 0; i < nodeCount; i++) {
+        if (i > 0) {
+            children[rng() % i].push_back(i);
+        }
+        bool userDefined = i % 3 != 0;
+        w.U16(userDefined ? AINB::UserDefined : AINB::Element_Sequential);
+        w.U16(i);
+        w.U16(0); // attachmentCount
+        w.U8(0); // flags
+        w.U8(0);
+        w.U32(userDefined ? strings.Add("Action_" + std::to_string(rng() % SYNTHETIC_ACTION_NAMES)) : 0);
+        w.U32(0); // nameHash
+        w.U32(0);
+        paramOffsetPos[i] = w.Pos();
+        w.U32(0);
+        w.Zeros(4 * sizeof(u16) + sizeof(u32) + 4 * sizeof(u16));
+        w.Zeros(16); // GUID
+    }
+
+    // Global parameters: two bools
+    w.PatchHeader(GlobalParamOffset, w.Pos());
+    for (u32 type = 0; type < AINB::ValueTypeCount; type++) {
+        w.U16(type == (u32) AINB::ValueType::Bool ? 2 : 0);
+        w.U16(0);
+        w.U32(0);
+    }
+    for (u32 i = 0; i < 2; i++) {
+        w.U32(strings.Add("Gparam" + std::to_string(i)) | (1 << 23));
+        w.U32(0);
+    }
+    w.U32(0);
+    w.U32(1);
+
+    // Immediate parameters: one int per node
+    w.PatchHeader(AttachmentParamsOffset, w.Pos());
+    w.PatchHeader(ImmParamOffset, w.Pos());
+    u32 immTable = w.Pos();
+    w.Zeros(AINB::ValueTypeCount * 4);
+    u32 immStart = w.Pos();
+    for (u32 i = 0; i < nodeCount; i++) {
+        w.U32(strings.Add("Imm" + std::to_string(i % 7)));
+        w.U32(0);
+        w.U32(i);
+    }
+    w.PatchU32(immTable, immStart);
+    for (u32 type = 1; type < AINB::ValueTypeCount; type++) {
+        w.PatchU32(immTable + type * 4, w.Pos());
+    }
+
+    // I/O parameters: one float input and output per node. The table holds the end
+    // of the inputs and outputs of each type, shifted by one entry.
+    w.PatchHeader(IOParamsOffset, w.Pos());
+    u32 ioTable = w.Pos();
+    w.Zeros(AINB::ValueTypeCount * 2 * 4);
+    u32 ioStart = w.Pos();
+    for (u32 i = 0; i < nodeCount; i++) {
+        w.U32(strings.Add("Input" + std::to_string(i % 5)));
+        w.U16(i == 0 ? (u16) -1 : (u16) (rng() % i));
+        w.U16(0);
+        w.U32(0);
+        w.F32(1.5f);
+    }
+    u32 floatInputEnd = w.Pos();
+    for (u32 i = 0; i < nodeCount; i++) {
+        w.U32(strings.Add("Output" + std::to_string(i % 3)));
+    }
+    u32 floatOutputEnd = w.Pos();
+    u32 floatIdx = (u32) AINB::ValueType::Float;
+    w.PatchU32(ioTable, ioStart);
+    for (u32 i = 1; i < AINB::ValueTypeCount * 2; i++) {
+        u32 stop = i - 1;
+        u32 end = ioStart;
+        if (stop == floatIdx * 2) {
+            end = floatInputEnd;
+        } else if (stop > floatIdx * 2) {
+            end = floatOutputEnd;
+        }
+        w.PatchU32(ioTable + i * 4, end);
+    }
+
+    w.PatchHeader(MultiParamArrOffset, w.Pos());
+    w.PatchHeader(ResidentUpdateArrOffset, w.Pos());
+    w.PatchHeader(PreconditionNodeArrOffset, w.Pos());
+    w.PatchHeader(ExbOffset, 0);
+
+    w.PatchHeader(EmbeddedAinbsOffset, w.Pos());
+    w.U32(1);
+    w.U32(strings.Add("Embedded/Child.module.ainb"));
+    w.U32(strings.Add("Logic"));
+    w.U32(1);
+
+    w.PatchHeader(EntryStringsOffset, w.Pos());
+    w.U32(0);
+
+    w.PatchHeader(X70SectionOffset, w.Pos());
+    w.U32(0);
+    w.U32(0);
+
+    w.PatchHeader(ChildReplacementTableOffset, w.Pos());
+    w.Zeros(4 * sizeof(u16));
+
+    // Parameter tables and flow links of each node
+    for (u32 i = 0; i < nodeCount; i++) {
+        w.PatchU32(paramOffsetPos[i], w.Pos());
+        for (u32 type = 0; type < AINB::ValueTypeCount; type++) {
+            bool isInt = type == (u32) AINB::ValueType::Int;
+            w.U32(isInt ? i : 0);
+            w.U32(isInt ? 1 : 0);
+        }
+        for (u32 type = 0; type < AINB::ValueTypeCount; type++) {
+            bool isFloat = type == floatIdx;
+            w.U32(isFloat ? i : 0);
+            w.U32(isFloat ? 1 : 0);
+            w.U32(isFloat ? i : 0);
+            w.U32(isFloat ? 1 : 0);
+        }
+        for (u32 type = 0; type < AINB::LinkTypeCount; type++) {
+            w.U8(type == (u32) AINB::LinkType::Flow ? children[i].size() : 0);
+            w.U8(0);
+        }
+        u32 linkOffsets = w.Pos();
+        w.Zeros(children[i].size() * 4);
+        for (size_t c = 0; c < children[i].size(); c++) {
+            w.PatchU32(linkOffsets + c * 4, w.Pos());
+            w.U32(children[i][c]);
+            w.U32(strings.Add("Flow" + std::to_string(c)));
+        }
+    }
+
+    w.PatchHeader(StringPoolOffset, w.Pos());
+    w.Raw(strings.Data().data(), strings.Data().size());
+    return w.data;
+}
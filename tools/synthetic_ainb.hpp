@@ -0,0 +1,11 @@
+#pragma once
+
+#include <vector>
+
+#include "types.h"
+
+// Builds an AINB file with the given number of nodes, for benchmarking graphs larger
+// than any that ship with the game. Every node has an int immediate, a float input
+// connected to an earlier node and a float output. Flow links form a random tree, a
+// third of the nodes are Sequential and the rest are user defined actions.
+std::vector<u8> MakeSyntheticAINB(u32 nodeCount, u32 seed);